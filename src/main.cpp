@@ -8,6 +8,30 @@
 #include <sstream>
 #include <chrono>
 #include <algorithm>
+#include <filesystem>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <set>
+#include <queue>
+#include <unordered_map>
+#include <list>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <cerrno>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <poll.h>
+#endif
 
 using namespace std;
 
@@ -16,6 +40,11 @@ const string GENERIC_ERROR = "Invalid input!"s;
 const string CELL_OCCUPIED = "That cell is occupied!"s;
 const string OUT_OF_BOUNDS = "Cannot move out of bounds!"s;
 
+const string NOTHING_TO_UNDO = "There are no moves to undo!"s;
+const string CANNOT_UNDO_THAT_MUCH = "Cannot undo that many moves!"s;
+
+const string REAL_TIME_UNAVAILABLE = "Real time games need a terminal!"s;
+
 const string INVALID_MAZE_NUMBER = "Must be a number from 1 to 99!"s;
 const string MAZE_NOT_FOUND = "That maze could not be found!"s;
 const string INVALID_MAZE_HEADER_SIZE = "Invalid maze size in header!"s;
@@ -24,9 +53,82 @@ const string NO_PLAYER = "Maze has no players!"s;
 const string MULTIPLE_PLAYERS = "Maze has multiple players!"s;
 const string INVALID_MAZE_CHARACTER = "Invalid character found in maze!"s;
 
+const string INVALID_MAZE_LINE = "Maze line does not match width in header!"s;
+
+const string INVALID_TILED_MAZE = "Tiled maze file is damaged!"s;
+const string TILED_SMART_ROBOTS = "Smart robots need the whole maze in memory, it cannot be tiled!"s;
+const string TILED_WRITE_FAILED = "Could not write the tiled maze file!"s;
+const string TILED_HEATMAPS = "Tiled mazes are too big for heatmaps!"s;
+
+const string SAVE_FOUND = "There is a saved game for this maze! Do you wish to resume it? (Y/n) "s;
+const string DAMAGED_SAVE = "The saved game is damaged, it was set aside and a new game will start!"s;
+
+const string NO_PROOF = "Entry has no moves to prove it!"s;
+const string WRONG_MAZE = "Entry was played on a different maze!"s;
+const string INVALID_PROOF = "Entry's moves are not possible!"s;
+const string NOT_A_WIN = "Entry's moves do not win the game!"s;
+const string WRONG_ENTRY = "Entry's moves belong to another name or time!"s;
+
 const string INVALID_NAME = "Must have 15 characters or fewer!"s;
 const string ANOTHER_NAME = "";
 
+/** Identifies a saved game file */
+const string SAVE_MAGIC = "RBSV"s;
+/** Version of the saved game format */
+const uint8_t SAVE_VERSION = 4;
+/** Identifies the file with the fences of a saved game's maze */
+const string SAVE_FENCES_MAGIC = "RBSF"s;
+/** In a saved game's flags, the maze is tiled */
+const uint8_t SAVE_TILED = 1;
+/** In a saved game's flags, the maze's robots are smart */
+const uint8_t SAVE_SMART_ROBOTS = 2;
+/** How many turns are played between automatic saves */
+const size_t AUTOSAVE_INTERVAL = 5;
+/** Waits shorter than this are played turn by turn, tracking the robots (see waitTurns) costs more than a few turns */
+const size_t MIN_TRACKED_WAIT = 16;
+/** How many turns are played between full copies of the robots in the history */
+const size_t KEYFRAME_INTERVAL = 64;
+/** How often robots move in real time games, unless the maze sets it */
+const chrono::milliseconds DEFAULT_TICK_INTERVAL(500);
+/** The most keys a player can press in a second, in real time games */
+const size_t MAX_KEYS_PER_SECOND = 1000;
+/** How many late ticks are run at once before giving up on catching up */
+const size_t MAX_CATCHUP_TICKS = 5;
+/** In a sequence of moves, marks robots moving without the player moving, in real time games */
+const char ROBOT_TICK = '.';
+/** In a maze's header, makes robots walk around fences */
+const string SMART_ROBOTS_OPTION = "smart"s;
+/** Identifies a trace file */
+const string TRACE_MAGIC = "RBTR"s;
+/** Version of the trace file format */
+const uint32_t TRACE_VERSION = 1;
+/** How many events fit in a tracing session's ring buffer, must be a power of two */
+const uint64_t TRACE_RING_SIZE = 1 << 16;
+/** How often the ring buffer is written to the trace file */
+const chrono::milliseconds TRACE_DRAIN_INTERVAL(10);
+/** Identifies a tiled maze file */
+const string TILED_MAGIC = "RBTL"s;
+/** Version of the tiled maze file format */
+const uint8_t TILED_VERSION = 1;
+/** Identifies a heatmaps file */
+const string HEATMAP_MAGIC = "RBHM"s;
+/** Version of the heatmaps file format */
+const uint8_t HEATMAP_VERSION = 1;
+/** How many recorded games a thread analyzes before getting more */
+const size_t ANALYSIS_BLOCK_SIZE = 256;
+/** How many blocks of recorded games wait to be analyzed at most, so game logs are never all in memory */
+const size_t ANALYSIS_QUEUE_SIZE = 16;
+/** How many cells a tile has on each side, one 64 bit row per line of the tile */
+const size_t TILE_SIZE = 64;
+/** How many tiles of a tiled maze are kept in memory, about 40MB */
+const size_t TILE_CACHE_SIZE = 1 << 16;
+/** How many tiles each thread keeps its own copy of, so most lookups don't lock the tiled maze */
+const size_t THREAD_TILE_CACHE_SIZE = 256;
+/** The most lines of a maze shown at once, bigger mazes scroll with the player */
+const size_t VIEW_LINES = 50;
+/** The most columns of a maze shown at once, bigger mazes scroll with the player */
+const size_t VIEW_COLUMNS = 150;
+
 /**
  * This struct represents an entry on the leaderboard.
  */
@@ -36,6 +138,23 @@ struct LeaderboardEntry
     string name;
     /** The player's points */
     unsigned int points;
+    /** Hash of the maze the game was played on, see computeMazeHash */
+    uint64_t mazeHash = 0;
+    /** The moves that won the game, encoded with encodeMoves, empty for entries without proof */
+    string moves;
+    /** Ties the moves to the name and points, see proofSeal */
+    uint64_t seal = 0;
+};
+
+/**
+ * This struct represents a game recorded in a maze's game log, see recordGame.
+ */
+struct GameRecord
+{
+    /** Hash of the maze the game was played on, see computeMazeHash */
+    uint64_t mazeHash = 0;
+    /** Everything that happened in the game, encoded with encodeMoves */
+    string moves;
 };
 
 /**
@@ -65,6 +184,194 @@ struct Entity
     }
 };
 
+/**
+ * This struct represents a change to a robot during a turn.
+ */
+struct RobotChange
+{
+    /** Index of the robot in the maze's robots */
+    size_t robot;
+    /** The robot before the turn */
+    Entity before = Entity(0, 0);
+    /** The robot after the turn */
+    Entity after = Entity(0, 0);
+};
+
+/**
+ * This struct holds only what changed during a turn.
+ */
+struct TurnDelta
+{
+    /** The player before the turn */
+    Entity playerBefore = Entity(0, 0);
+    /** The player after the turn */
+    Entity playerAfter = Entity(0, 0);
+    /** The robots that moved or died */
+    vector<RobotChange> robots;
+    /** How many turns went by, more than one when waiting */
+    size_t turns = 1;
+};
+
+/**
+ * This struct holds the full state of the entities at some turn.
+ */
+struct Keyframe
+{
+    /** The player */
+    Entity player = Entity(0, 0);
+    /** All the robots */
+    vector<Entity> robots;
+};
+
+/**
+ * This struct holds the turns played, used to undo moves.
+ */
+struct History
+{
+    /** Every turn played, turns[i] goes from turn i to turn i + 1 (counting from when the history started) */
+    vector<TurnDelta> turns;
+    /** The state every KEYFRAME_INTERVAL turns, keyframes[i] is the state at turn i * KEYFRAME_INTERVAL */
+    vector<Keyframe> keyframes;
+};
+
+/**
+ * This struct holds cells sorted along every horizontal, vertical and diagonal line through them, 
+ * to find the first one in some direction from a cell quickly.
+ */
+struct LineIndex
+{
+    /** The cells' positions along each line, sorted, by line key (see lineKey) */
+    unordered_map<uint64_t, vector<uint32_t>> lines;
+};
+
+/**
+ * This struct holds the robots while waiting, see waitTurns. 
+ * Between events a robot walks in a straight line, so it's kept as the cell it would have started from 
+ * on turn 0 and is only looked at again when something happens to it.
+ */
+struct WaitTracker
+{
+    /** How many turns have been played */
+    size_t turn = 0;
+    /** How many robots are alive */
+    size_t alive = 0;
+    /** Each robot's direction, see directionIndex */
+    vector<uint8_t> directions;
+    /** Each robot's cell on turn 0, line then column */
+    vector<pair<long, long>> starts;
+    /** 
+     * The alive robots by direction, by line through their starting cell and by position along it, see directionLine. 
+     * During a turn a robot that moved may share its starting cell with one about to run into it
+     */
+    array<unordered_map<long, multimap<long, size_t>>, 9> lines;
+    /** A robot in each cell with dead robots, by map index */
+    unordered_map<size_t, size_t> deadCells;
+    /** The dead robots' positions along each line, by line key (see lineKey) */
+    unordered_map<uint64_t, set<uint32_t>> deadLines;
+    /** The turn each robot's next event happens on */
+    vector<size_t> nextEvents;
+    /** The robots' next events, turn then robot, earliest first. Entries that don't match nextEvents are outdated */
+    priority_queue<pair<size_t, size_t>, vector<pair<size_t, size_t>>, greater<pair<size_t, size_t>>> events;
+    /** The robots that must be played on the next turn because they may run into another one */
+    set<size_t> forced;
+};
+
+/**
+ * This struct holds a tile of a tiled maze that is in memory.
+ */
+struct CachedTile
+{
+    /** The tile's fences, one bit per cell, a row per line */
+    array<uint64_t, TILE_SIZE> rows;
+    /** Where the tile is in TileStore::recent */
+    list<size_t>::iterator age;
+};
+
+/**
+ * This struct holds a thread's own copy of a tile, see tileFence.
+ */
+struct ThreadTile
+{
+    /** The tiled maze the tile is from, see TileStore::id, 0 if there's no tile */
+    uint64_t store = 0;
+    /** The tile number */
+    size_t tile = 0;
+    /** The tile's fences, one bit per cell, a row per line */
+    array<uint64_t, TILE_SIZE> rows;
+};
+
+/**
+ * This struct holds the fences of a maze too big to keep in memory. 
+ * They are split in square tiles, stored in a file and read only when needed. 
+ * Tiles without fences are not stored at all.
+ */
+struct TileStore
+{
+    /** Tells tiled mazes apart in the threads' copies of their tiles, see tileFence */
+    uint64_t id = 0;
+    /** The tiled maze file */
+    ifstream file;
+    /** How many tiles there are on the x-axis */
+    size_t tileCols = 0;
+    /** Where each tile is in the file, 0 if the tile has no fences */
+    vector<uint64_t> offsets;
+    /** Protects the file and the cache, games on the same maze may run on many threads */
+    mutex lock;
+    /** The tiles in memory, by tile number */
+    unordered_map<size_t, CachedTile> cache;
+    /** The tiles in memory, most recently used first */
+    list<size_t> recent;
+};
+
+/**
+ * This struct holds the parts of a maze that never change during a game.
+ */
+struct MazeLayout
+{
+    /** Size of the maze on the x-axis */
+    size_t nCols = 0;
+    /** Size of the maze on the y-axis */
+    size_t nLines = 0;
+    /** Maze map containing only the fences/posts, empty if the maze is tiled */
+    vector<char> fenceMap;
+    /** The fences/posts along every line, to find the next one in a direction, empty if the maze is tiled */
+    LineIndex fenceLines;
+    /** The fences/posts of a maze too big for fenceMap, nullptr if the maze isn't tiled */
+    shared_ptr<TileStore> tiles;
+    /** The robots when the game starts */
+    vector<Entity> robots;
+    /** The player when the game starts */
+    Entity player = Entity(0, 0);
+    /** Hash of the maze's contents, see computeMazeHash */
+    uint64_t hash = 0;
+    /** How often robots move in real time games */
+    chrono::milliseconds tickInterval = DEFAULT_TICK_INTERVAL;
+    /** Whether robots walk around fences instead of straight towards the player */
+    bool smartRobots = false;
+    /** When the maze's file was last changed */
+    filesystem::file_time_type modified;
+};
+
+/**
+ * This struct holds how far each cell is from the player, walking around fences. 
+ * Shared by every smart robot, and only computed as far as the robots are.
+ */
+struct FlowField
+{
+    /** The cell distances are measured to, the player's */
+    size_t source = SIZE_MAX;
+    /** Distances are only valid in cells whose stamp is the current generation */
+    uint32_t generation = 0;
+    /** The generation each cell's distance was found in */
+    vector<uint32_t> stamp;
+    /** How many moves it takes to go from each cell to the source */
+    vector<uint32_t> distance;
+    /** The cells found by the breadth first search, in order */
+    vector<size_t> queue;
+    /** The next cell of the queue to expand */
+    size_t queueFront = 0;
+};
+
 /**
  * This struct holds all the information needed for a game to be played.
  */
@@ -78,15 +385,35 @@ struct Maze
     string mazeNumber;
     /** When the player started playing */
     chrono::steady_clock::time_point startTime;
+    /** How many turns have been played */
+    size_t turn = 0;
+    /** What happened every turn, see replayMove */
+    string moves;
+    /** Whether robots move on their own every tickInterval instead of after the player */
+    bool realTime = false;
 
-    /** Maze map containing only the fences/posts */
-    vector<char> fenceMap;
-    /** The full maze map, created from the fenceMap */
+    /** The parts of the maze that never change, shared by every game on it */
+    shared_ptr<const MazeLayout> layout;
+    /** The part of the maze map around the player, created from the fences, only when the maze is shown */
     vector<char> visualMap;
+    /** The first line shown in visualMap */
+    size_t viewLine = 0;
+    /** The first column shown in visualMap */
+    size_t viewColumn = 0;
+    /** How many lines visualMap has */
+    size_t viewLines = 0;
+    /** How many columns visualMap has */
+    size_t viewCols = 0;
     /** A vector that holds all the robots */
     vector<Entity> robots;
+    /** Which robot is in each cell, by map index. If there are many they're all dead, so any of them will do */
+    unordered_map<size_t, size_t> robotCells;
     /** The player */
     Entity player = Entity(0, 0);
+    /** The turns played, used to undo moves */
+    History history;
+    /** Distances to the player, only used if the maze has smart robots */
+    FlowField flowField;
 
     /**
      * Converts a column and a line into an index usable with this struct's maps.
@@ -102,6 +429,19 @@ struct Maze
     }
 };
 
+/**
+ * This struct holds what is needed to only redraw what changed in the maze.
+ */
+struct Renderer
+{
+    /** The visualMap that is on screen, empty if nothing is */
+    vector<char> lastFrame;
+    /** Where frames are built before being written, reused to avoid allocating every frame */
+    string buffer;
+    /** Whether something else was printed over the last frame, so the next one must be drawn in full */
+    bool redraw = true;
+};
+
 /**
  * This enum represents state the game is in.
  */
@@ -117,6 +457,198 @@ enum class GameState
     finished
 };
 
+/**
+ * This enum represents the kinds of events recorded while tracing a session.
+ */
+enum class TraceEventType : uint8_t
+{
+    /** The game changed state, detail is the new GameState and a the previous one */
+    stateChange,
+    /** The player moved, detail is the movement key, a the turn and b the new cell */
+    playerMove,
+    /** The player died, detail is the DeathCause, a the turn and b the cell */
+    playerDeath,
+    /** A robot died, detail is the DeathCause, a the robot, b the cell and c the other robot plus one, if any */
+    robotDeath,
+    /** A maze was loaded, detail is 1 if it was valid, a the maze number, b the hash and c the number of robots */
+    mazeLoad,
+    /** A leaderboard was saved, a is the maze number and b the number of entries */
+    leaderboardWrite,
+    /** The ring buffer was full, b is how many events were lost */
+    eventsDropped
+};
+
+/**
+ * This enum represents what killed an entity.
+ */
+enum class DeathCause : uint8_t
+{
+    /** Stepped onto a fence/post */
+    fence,
+    /** Collided with a robot */
+    robot
+};
+
+/**
+ * This struct represents an event recorded while tracing, written to the trace file as is.
+ */
+struct TraceEvent
+{
+    /** When the event happened, in nanoseconds since tracing started */
+    uint64_t time;
+    /** The kind of event */
+    TraceEventType type;
+    /** Depends on the type of event */
+    uint8_t detail;
+    /** Unused, keeps the struct's layout the same everywhere */
+    uint16_t padding;
+    /** Depends on the type of event */
+    uint32_t a;
+    /** Depends on the type of event */
+    uint64_t b;
+    /** Depends on the type of event */
+    uint64_t c;
+};
+
+static_assert(sizeof(TraceEvent) == 32, "Trace events must have the same size in every build");
+
+/**
+ * This struct holds a tracing session: a ring buffer written to by the game's thread without locks, 
+ * and drained to a file by another thread.
+ */
+struct Tracer
+{
+    /** The ring buffer, its size is a power of two */
+    vector<TraceEvent> ring = vector<TraceEvent>(TRACE_RING_SIZE);
+    /** How many events were ever written, only changed by the game's thread */
+    atomic<uint64_t> head{0};
+    /** How many events were ever drained, only changed by the draining thread */
+    atomic<uint64_t> tail{0};
+    /** How many events were lost since the last drain */
+    atomic<uint64_t> dropped{0};
+    /** Whether the draining thread should keep running */
+    atomic<bool> running{false};
+    /** The draining thread */
+    thread drainer;
+    /** Where the events are written */
+    ofstream file;
+    /** When tracing started */
+    chrono::steady_clock::time_point start;
+};
+
+/** The tracing session of the current thread, nullptr if it's not being traced */
+thread_local Tracer *sessionTracer = nullptr;
+
+/**
+ * Records an event if the current thread is being traced. 
+ * Never blocks, if the ring buffer is full the event is counted as dropped.
+ * 
+ * @param type The kind of event
+ * @param detail Depends on the type of event
+ * @param a Depends on the type of event
+ * @param b Depends on the type of event
+ * @param c Depends on the type of event
+ */
+void traceEvent(const TraceEventType type, const uint8_t detail = 0, const uint32_t a = 0, const uint64_t b = 0, const uint64_t c = 0)
+{
+    Tracer *tracer = sessionTracer;
+    if (!tracer)
+        return;
+
+    uint64_t head = tracer->head.load(memory_order_relaxed);
+    if (head - tracer->tail.load(memory_order_acquire) >= TRACE_RING_SIZE)
+    {
+        tracer->dropped.fetch_add(1, memory_order_relaxed);
+        return;
+    }
+
+    uint64_t time = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - tracer->start).count();
+    tracer->ring[head % TRACE_RING_SIZE] = {time, type, detail, 0, a, b, c};
+    tracer->head.store(head + 1, memory_order_release);
+}
+
+/**
+ * Writes every event in the ring buffer to the trace file.
+ * 
+ * @param tracer The tracing session
+ */
+void drainTrace(Tracer &tracer)
+{
+    uint64_t tail = tracer.tail.load(memory_order_relaxed);
+    uint64_t head = tracer.head.load(memory_order_acquire);
+
+    // At most two writes, the ring may wrap around
+    while (tail < head)
+    {
+        uint64_t first = tail % TRACE_RING_SIZE;
+        uint64_t count = min(head - tail, TRACE_RING_SIZE - first);
+
+        tracer.file.write(reinterpret_cast<const char *>(&tracer.ring[first]), count * sizeof(TraceEvent));
+        tail += count;
+        tracer.tail.store(tail, memory_order_release);
+    }
+
+    uint64_t dropped = tracer.dropped.exchange(0, memory_order_relaxed);
+    if (dropped)
+    {
+        uint64_t time = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - tracer.start).count();
+        TraceEvent event = {time, TraceEventType::eventsDropped, 0, 0, 0, dropped, 0};
+        tracer.file.write(reinterpret_cast<const char *>(&event), sizeof(event));
+    }
+}
+
+/**
+ * Starts tracing the current thread's session into a file.
+ * 
+ * @param tracer The tracing session
+ * @param path The trace file
+ * 
+ * @returns false if the file could not be created
+ */
+bool startTracing(Tracer &tracer, const string &path)
+{
+    tracer.file.open(path, ios::binary);
+    if (!tracer.file.is_open())
+        return false;
+
+    tracer.start = chrono::steady_clock::now();
+    uint64_t startTime = chrono::duration_cast<chrono::nanoseconds>(chrono::system_clock::now().time_since_epoch()).count();
+
+    tracer.file.write(TRACE_MAGIC.data(), TRACE_MAGIC.length());
+    tracer.file.write(reinterpret_cast<const char *>(&TRACE_VERSION), sizeof(TRACE_VERSION));
+    tracer.file.write(reinterpret_cast<const char *>(&startTime), sizeof(startTime));
+
+    tracer.running = true;
+    tracer.drainer = thread([&tracer]()
+                            {
+                                while (tracer.running)
+                                {
+                                    drainTrace(tracer);
+                                    this_thread::sleep_for(TRACE_DRAIN_INTERVAL);
+                                }
+                            });
+
+    sessionTracer = &tracer;
+    return true;
+}
+
+/**
+ * Stops tracing and writes whatever events are left.
+ * 
+ * @param tracer The tracing session
+ */
+void stopTracing(Tracer &tracer)
+{
+    sessionTracer = nullptr;
+
+    tracer.running = false;
+    if (tracer.drainer.joinable())
+        tracer.drainer.join();
+
+    drainTrace(tracer);
+    tracer.file.close();
+}
+
 /**
  * Normalizes input. 
  * Replaces all tabs with spaces, removes duplicate spaces and trims spaces from the start and the end.
@@ -202,6 +734,18 @@ size_t utf8Length(const string &str)
     return length;
 }
 
+/**
+ * Checks if a string is made only of digits.
+ * 
+ * @param text The string
+ * @returns true if every character is a digit, also if there are none
+ */
+bool allDigits(const string &text)
+{
+    return all_of(text.begin(), text.end(), [](unsigned char c)
+                  { return isdigit(c); });
+}
+
 /**
  * Returns the sign of a number.
  * 
@@ -229,8 +773,13 @@ bool printRules()
             "\tA S D\n"
             "\tZ X C\n"
             "(Where 'S' keeps you in your current position)\n"
+            "You can undo your last move by typing 'U', or the last N moves by typing 'U N'.\n"
+            "You can wait for N turns by typing 'S N', or until a robot or you die by typing 'S !'.\n"
             "After you move all alive robots will move towards you without avoiding obstacles.\n"
-            "You may leave the game at any time by typing Ctrl-Z on Windows or Ctrl-D on Linux.\n\n"
+            "In real time games robots don't wait for you, they move on their own every few moments.\n"
+            "In some mazes robots are smart and walk around fences to reach you.\n"
+            "You may leave the game at any time by typing Ctrl-Z on Windows or Ctrl-D on Linux.\n"
+            "A game left halfway is saved and can be resumed by choosing the same maze again.\n\n"
 
             "Press enter to continue\n";
 
@@ -238,13 +787,28 @@ bool printRules()
     return getInput(s);
 }
 
+/**
+ * Checks if real time games can be played, which needs raw input from a terminal.
+ * 
+ * @returns true if real time games can be played
+ */
+bool realTimeAvailable()
+{
+#ifdef _WIN32
+    return false;
+#else
+    return isatty(STDIN_FILENO) && isatty(STDOUT_FILENO);
+#endif
+}
+
 /**
  * The start of the game. Asks the user what he wants to do.
  * 
  * @param gameState The game state
+ * @param realTime Set to whether the user wants to play in real time
  * @returns false if the user wants to exit the game
  */
-bool mainMenu(GameState &gameState, bool &validInput, string &errorMessage)
+bool mainMenu(GameState &gameState, bool &realTime, bool &validInput, string &errorMessage)
 {
     string input;
 
@@ -253,6 +817,7 @@ bool mainMenu(GameState &gameState, bool &validInput, string &errorMessage)
         cout << "Main menu: \n\n"
                 "1) Rules \n"
                 "2) Play \n"
+                "3) Play in real time \n"
                 "0) Exit \n\n";
 
     cout << "Please insert option: ";
@@ -269,12 +834,18 @@ bool mainMenu(GameState &gameState, bool &validInput, string &errorMessage)
         cout << "\n";
         return printRules(); // Show the rules
     }
-    else if (input == "2")
+    else if (input == "2" || (input == "3" && realTimeAvailable()))
     {
         // New line for spacing
         cout << "\n";
+        realTime = input == "3";
         gameState = GameState::mazeMenu; // Pick the maze
     }
+    else if (input == "3")
+    {
+        validInput = false;
+        errorMessage = REAL_TIME_UNAVAILABLE;
+    }
     else if (input == "0")
     {
         return false; // Leave the game
@@ -297,666 +868,5036 @@ bool mainMenu(GameState &gameState, bool &validInput, string &errorMessage)
  */
 bool validMazeNumber(const string &number)
 {
-    return number.length() == 2 && isdigit(number.at(0)) && isdigit(number.at(1));
+    return number.length() == 2 && allDigits(number);
 }
 
 /**
- * Loads a maze from the respective file. 
- * Tries to handle invalid files.
+ * Gets how the player moves with each key.
  * 
- * @param maze The maze
- * @param validInput Whether the last input was valid. Set to false if file is invalid
- * @param errorMessage The reason why the file is invalid
+ * @param move The key, in lower case
+ * @param columnDelta How many cells to move in the x axis
+ * @param lineDelta How many cells to move in the y axis
  * 
- * @returns false if the maze was not loaded
+ * @returns false if the key is not a movement key
  */
-bool loadMaze(Maze &maze, bool &validInput, string &errorMessage)
+bool moveDelta(const char move, int &columnDelta, int &lineDelta)
 {
-    // Open file
-    ifstream file("MAZE_"s + maze.mazeNumber + ".txt"s);
+    static const string keys = "qweasdzxc"s;
 
-    // File doesn't exist
-    if (!file.is_open())
-    {
-        validInput = false;
-        errorMessage = MAZE_NOT_FOUND;
+    size_t key = keys.find(move);
+    if (move == 0 || key == string::npos)
         return false;
-    }
 
-    // Get number of rows and columns from top of file
-    char x;
-    file >> maze.nLines >> x >> maze.nCols;
+    columnDelta = int(key % 3) - 1;
+    lineDelta = int(key / 3) - 1;
+    return true;
+}
 
-    if (x != 'x' || file.fail())
-    {
-        validInput = false;
-        errorMessage = INVALID_MAZE_HEADER_SIZE;
-        return false;
-    }
+/**
+ * Parses the optional part of a maze's header, after the size, made of any of:
+ * - How many milliseconds robots take to move in real time games
+ * - "smart", if robots walk around fences
+ * 
+ * @param options The rest of the header
+ * @param tickInterval Where the interval is stored, unchanged if there's none
+ * @param smartRobots Set to true if robots are smart, unchanged otherwise
+ * 
+ * @returns false if the options are invalid
+ */
+bool parseMazeOptions(const string &options, chrono::milliseconds &tickInterval, bool &smartRobots)
+{
+    stringstream optionStream(options);
+    string option;
 
-    char c;
-    maze.player.alive = false;
-    size_t i = 0;
-    while (file.get(c))
+    while (optionStream >> option)
     {
-        switch (c)
+        if (option == SMART_ROBOTS_OPTION)
         {
-        case '\n':
-            // Ignore newlines
+            smartRobots = true;
             continue;
-        case 'R':
-            maze.robots.push_back(Entity(i % maze.nCols, i / maze.nCols));
-            maze.fenceMap.push_back(' ');
-            break;
-        case 'H':
-            if (maze.player.alive)
-            {
-                // Found two players
-                validInput = false;
-                errorMessage = MULTIPLE_PLAYERS;
-                return false;
-            }
-            maze.player = Entity(i % maze.nCols, i / maze.nCols);
-            maze.fenceMap.push_back(' ');
-            break;
-        case ' ':
-            maze.fenceMap.push_back(' ');
-            break;
-        case '*':
-            maze.fenceMap.push_back('*');
-            break;
-        default:
-            // Found an invalid character
-            validInput = false;
-            errorMessage = INVALID_MAZE_CHARACTER;
-            return false;
         }
 
-        i++;
-    }
-
-    if (!maze.player.alive)
-    {
-        // No player was found
-        validInput = false;
-        errorMessage = NO_PLAYER;
-        return false;
-    }
+        if (option.length() > 9 || !allDigits(option) || stoul(option) == 0)
+            return false;
 
-    if (maze.nCols * maze.nLines != maze.fenceMap.size())
-    {
-        // Size in header does not match maze size
-        validInput = false;
-        errorMessage = INVALID_MAZE_SIZE;
-        return false;
+        tickInterval = chrono::milliseconds(stoul(option));
     }
 
-    file.close();
     return true;
 }
 
 /**
- * Receives input from the player and loads the respective maze.
+ * Adds a byte to a 64 bit FNV-1a hash.
  * 
- * @param gameState The game state
- * @param maze Where the maze is stored
+ * @param hash The hash
+ * @param byte The byte
+ */
+void hashByte(uint64_t &hash, const uint64_t byte)
+{
+    hash ^= byte;
+    hash *= 0x100000001b3ull;
+}
+
+/**
+ * Starts the hash of a maze's contents with its size, see computeMazeHash.
  * 
- * @returns false if the player wants to exit the game
+ * @param nLines Size of the maze on the y-axis
+ * @param nCols Size of the maze on the x-axis
+ * @returns The hash, cells are added to it with hashByte
  */
-bool mazeMenu(GameState &gameState, Maze &maze, bool &validInput, string &errorMessage)
+uint64_t startMazeHash(const size_t nLines, const size_t nCols)
 {
-    // Reset maze variable
-    maze = Maze();
+    uint64_t hash = 0xcbf29ce484222325ull;
 
-    validInput = true;
+    for (int i = 0; i < 64; i += 8)
+    {
+        hashByte(hash, (nLines >> i) & 0xff);
+        hashByte(hash, (nCols >> i) & 0xff);
+    }
 
-    // Ask user for input
-    cout << "Input number of the maze: ";
+    return hash;
+}
+
+/**
+ * Computes a hash of a maze's contents as loaded: its size, fences, robots and player. 
+ * Used to prove which maze a leaderboard entry was played on.
+ * 
+ * @param layout The maze's layout
+ * @returns The hash
+ */
+uint64_t computeMazeHash(const MazeLayout &layout)
+{
+    uint64_t hash = startMazeHash(layout.nLines, layout.nCols);
+
+    vector<char> cells = layout.fenceMap;
+    for (const Entity &robot : layout.robots)
+        cells.at(robot.line * layout.nCols + robot.column) = 'R';
+    cells.at(layout.player.line * layout.nCols + layout.player.column) = 'H';
+
+    for (char cell : cells)
+        hashByte(hash, static_cast<unsigned char>(cell));
+
+    // Smart robots make it a different game, but old hashes stay the same
+    if (layout.smartRobots)
+        hashByte(hash, 'S');
+
+    return hash;
+}
+
+/**
+ * Encodes a sequence of movement keys compactly, by writing how many times a key repeats before it. 
+ * "xxxxz" becomes "4xz".
+ * 
+ * @param moves The movement keys
+ * @returns The encoded moves
+ */
+string encodeMoves(const string &moves)
+{
+    string encoded;
+
+    for (size_t i = 0; i < moves.length();)
+    {
+        size_t count = 1;
+        while (i + count < moves.length() && moves[i + count] == moves[i])
+            count++;
+
+        if (count > 1)
+            encoded += to_string(count);
+        encoded += moves[i];
+
+        i += count;
+    }
+
+    return encoded;
+}
+
+/**
+ * Counts how many times the robots moved in a sequence of moves.
+ * 
+ * @param moves The moves, see replayMove
+ * @returns How many turns the moves took
+ */
+size_t countTurns(const string &moves)
+{
+    return count_if(moves.begin(), moves.end(), [](char c)
+                    { return islower(static_cast<unsigned char>(c)) || c == ROBOT_TICK; });
+}
+
+/**
+ * Decodes a sequence of movement keys encoded with encodeMoves a run at a time, 
+ * so they never have to be stored all at once.
+ * 
+ * @param encoded The encoded moves
+ * @param play Called with every movement key and how many times in a row it's played, returns false to stop
+ * 
+ * @returns false if the encoded moves are invalid or play stopped
+ */
+bool decodeMoveRuns(const string &encoded, const function<bool(char, size_t)> &play)
+{
+    size_t count = 0;
+
+    for (char c : encoded)
+    {
+        if (isdigit(static_cast<unsigned char>(c)))
+        {
+            count = count * 10 + (c - '0');
+            if (count > 100000000)
+                return false;
+            continue;
+        }
+
+        int columnDelta, lineDelta;
+        if (c != ROBOT_TICK && !moveDelta(tolower(static_cast<unsigned char>(c)), columnDelta, lineDelta))
+            return false;
+
+        if (!play(c, max<size_t>(count, 1)))
+            return false;
+        count = 0;
+    }
+
+    return count == 0;
+}
+
+/**
+ * Decodes a sequence of movement keys encoded with encodeMoves.
+ * 
+ * @param encoded The encoded moves
+ * @param moves Where the movement keys are stored
+ * @param maxTurns The most turns the moves may take, see countTurns
+ * 
+ * @returns false if the encoded moves are invalid or take too many turns
+ */
+bool decodeMoves(const string &encoded, string &moves, const size_t maxTurns = SIZE_MAX)
+{
+    moves.clear();
+    size_t turns = 0;
+
+    auto append = [&](const char move, const size_t count)
+    {
+        if (islower(static_cast<unsigned char>(move)) || move == ROBOT_TICK)
+            turns += count;
+
+        moves.append(count, move);
+        return turns <= maxTurns;
+    };
+
+    return decodeMoveRuns(encoded, append);
+}
+
+/**
+ * Gets the key of the line through a cell in a direction, used with LineIndex.
+ * 
+ * @param line The cell's line
+ * @param column The cell's column
+ * @param lineDelta The direction on the y-axis, -1, 0 or 1
+ * @param columnDelta The direction on the x-axis, -1, 0 or 1, not both 0
+ * @param position Set to the cell's position along the line
+ * 
+ * @returns The key
+ */
+uint64_t lineKey(const long line, const long column, const int lineDelta, const int columnDelta, uint32_t &position)
+{
+    // Horizontal lines are sorted by column, every other line by line
+    position = lineDelta == 0 ? column : line;
+
+    uint64_t kind, value;
+    if (lineDelta == 0)
+        kind = 0, value = line;
+    else if (columnDelta == 0)
+        kind = 1, value = column;
+    else if (lineDelta == columnDelta)
+        kind = 2, value = line - column + (1l << 40);
+    else
+        kind = 3, value = line + column;
+
+    return kind << 62 | value;
+}
+
+/**
+ * Adds a cell to every line through it.
+ * 
+ * @param index The index
+ * @param line The cell's line
+ * @param column The cell's column
+ */
+void addToLineIndex(LineIndex &index, const size_t line, const size_t column)
+{
+    static const int directions[4][2] = {{0, 1}, {1, 0}, {1, 1}, {1, -1}};
+
+    for (const auto &direction : directions)
+    {
+        uint32_t position;
+        index.lines[lineKey(line, column, direction[0], direction[1], position)].push_back(position);
+    }
+}
+
+/**
+ * Sorts the lines of an index, must be done after adding cells and before searching.
+ * 
+ * @param index The index
+ */
+void sortLineIndex(LineIndex &index)
+{
+    for (auto &line : index.lines)
+        sort(line.second.begin(), line.second.end());
+}
+
+/**
+ * Finds the first cell of an index when going from a cell in a straight line.
+ * 
+ * @param index The index
+ * @param line The starting cell's line
+ * @param column The starting cell's column
+ * @param lineDelta The direction on the y-axis, -1, 0 or 1
+ * @param columnDelta The direction on the x-axis, -1, 0 or 1, not both 0
+ * 
+ * @returns How many steps it takes to get there, SIZE_MAX if there's no cell that way
+ */
+size_t stepsToIndexedCell(const LineIndex &index, const long line, const long column, const int lineDelta, const int columnDelta)
+{
+    uint32_t position;
+    auto found = index.lines.find(lineKey(line, column, lineDelta, columnDelta, position));
+    if (found == index.lines.end())
+        return SIZE_MAX;
+
+    const vector<uint32_t> &cells = found->second;
+    const int step = lineDelta == 0 ? columnDelta : lineDelta;
+
+    if (step > 0)
+    {
+        auto next = upper_bound(cells.begin(), cells.end(), position);
+        return next == cells.end() ? SIZE_MAX : *next - position;
+    }
+
+    auto next = lower_bound(cells.begin(), cells.end(), position);
+    return next == cells.begin() ? SIZE_MAX : position - *(next - 1);
+}
+
+/**
+ * Indexes the fences/posts of a layout along every line.
+ * 
+ * @param layout The layout
+ */
+void indexFences(MazeLayout &layout)
+{
+    for (size_t i = 0; i < layout.fenceMap.size(); i++)
+    {
+        if (layout.fenceMap[i] == '*')
+            addToLineIndex(layout.fenceLines, i / layout.nCols, i % layout.nCols);
+    }
+
+    sortLineIndex(layout.fenceLines);
+}
+
+/**
+ * Reads a maze file into a layout. 
+ * Tries to handle invalid files.
+ * 
+ * @param mazeNumber The maze number (in the range "01" to "99")
+ * @param layout Where the maze is stored
+ * @param errorMessage The reason why the file is invalid
+ * 
+ * @returns false if the maze was not read
+ */
+bool readMazeLayout(const string &mazeNumber, MazeLayout &layout, string &errorMessage)
+{
+    // Open file
+    ifstream file("MAZE_"s + mazeNumber + ".txt"s);
+
+    // File doesn't exist
+    if (!file.is_open())
+    {
+        errorMessage = MAZE_NOT_FOUND;
+        return false;
+    }
+
+    // Get number of rows and columns from top of file
+    char x;
+    file >> layout.nLines >> x >> layout.nCols;
+    bool validHeader = x == 'x' && !file.fail();
+
+    // The rest of the header may set the tick interval
+    string options;
+    if (validHeader)
+    {
+        getline(file, options);
+        validHeader = parseMazeOptions(options, layout.tickInterval, layout.smartRobots);
+    }
+
+    if (!validHeader)
+    {
+        errorMessage = INVALID_MAZE_HEADER_SIZE;
+        return false;
+    }
+
+    char c;
+    layout.player.alive = false;
+    size_t i = 0;
+    while (file.get(c))
+    {
+        switch (c)
+        {
+        case '\n':
+            // Ignore newlines
+            continue;
+        case 'R':
+            layout.robots.push_back(Entity(i % layout.nCols, i / layout.nCols));
+            layout.fenceMap.push_back(' ');
+            break;
+        case 'H':
+            if (layout.player.alive)
+            {
+                // Found two players
+                errorMessage = MULTIPLE_PLAYERS;
+                return false;
+            }
+            layout.player = Entity(i % layout.nCols, i / layout.nCols);
+            layout.fenceMap.push_back(' ');
+            break;
+        case ' ':
+            layout.fenceMap.push_back(' ');
+            break;
+        case '*':
+            layout.fenceMap.push_back('*');
+            break;
+        default:
+            // Found an invalid character
+            errorMessage = INVALID_MAZE_CHARACTER;
+            return false;
+        }
+
+        i++;
+    }
+
+    if (!layout.player.alive)
+    {
+        // No player was found
+        errorMessage = NO_PLAYER;
+        return false;
+    }
+
+    if (layout.nCols * layout.nLines != layout.fenceMap.size())
+    {
+        // Size in header does not match maze size
+        errorMessage = INVALID_MAZE_SIZE;
+        return false;
+    }
+
+    layout.hash = computeMazeHash(layout);
+    indexFences(layout);
+
+    file.close();
+    return true;
+}
+
+/**
+ * Gets the name of a maze's tiled file, see tileCommand.
+ * 
+ * @param mazeNumber The maze number (in the range "01" to "99")
+ * @returns The file name
+ */
+string tiledMazeFileName(const string &mazeNumber)
+{
+    return "MAZE_"s + mazeNumber + ".tiles"s;
+}
+
+/**
+ * Reads a tiled maze file into a layout. Only the robots, the player and where each tile is are read, 
+ * the tiles are read by tileFence when needed.
+ * 
+ * @param mazeNumber The maze number (in the range "01" to "99")
+ * @param layout Where the maze is stored
+ * @param errorMessage The reason why the file is invalid
+ * 
+ * @returns false if the maze was not read
+ */
+bool readTiledLayout(const string &mazeNumber, MazeLayout &layout, string &errorMessage)
+{
+    static atomic<uint64_t> storeCount(0);
+
+    auto tiles = make_shared<TileStore>();
+    tiles->id = ++storeCount;
+    ifstream &file = tiles->file;
+    file.open(tiledMazeFileName(mazeNumber), ios::binary);
+
+    if (!file.is_open())
+    {
+        errorMessage = MAZE_NOT_FOUND;
+        return false;
+    }
+
+    string magic(TILED_MAGIC.length(), 0);
+    uint8_t version = 0;
+    uint64_t nLines = 0, nCols = 0, tickInterval = 0, hash = 0, player = 0, nRobots = 0, robotsOffset = 0;
+
+    file.read(&magic[0], magic.length());
+    file.read(reinterpret_cast<char *>(&version), sizeof(version));
+    for (uint64_t *value : {&nLines, &nCols, &tickInterval, &hash, &player, &nRobots, &robotsOffset})
+        file.read(reinterpret_cast<char *>(value), sizeof(*value));
+
+    error_code error;
+    const uint64_t fileSize = filesystem::file_size(tiledMazeFileName(mazeNumber), error);
+
+    const size_t cells = nLines * nCols;
+    const size_t tileCount = (nLines + TILE_SIZE - 1) / TILE_SIZE * ((nCols + TILE_SIZE - 1) / TILE_SIZE);
+
+    // Check the sizes before trusting them with memory, and the tick interval like parseMazeOptions does: 
+    // robots that never wait would hang real time games
+    bool valid = file && !error && magic == TILED_MAGIC && version == TILED_VERSION && player < cells &&
+                 tickInterval > 0 && tickInterval < 1000000000 &&
+                 tileCount <= fileSize / sizeof(uint64_t) && nRobots <= fileSize / sizeof(uint64_t);
+
+    if (valid)
+    {
+        tiles->tileCols = (nCols + TILE_SIZE - 1) / TILE_SIZE;
+        tiles->offsets.resize(tileCount);
+        file.read(reinterpret_cast<char *>(tiles->offsets.data()), tiles->offsets.size() * sizeof(uint64_t));
+    }
+
+    vector<uint64_t> robots(valid ? nRobots : 0);
+    file.seekg(robotsOffset);
+    file.read(reinterpret_cast<char *>(robots.data()), robots.size() * sizeof(uint64_t));
+
+    valid = valid && file;
+    for (uint64_t robot : robots)
+        valid = valid && robot < cells;
+    for (uint64_t offset : tiles->offsets)
+        valid = valid && offset + sizeof(CachedTile::rows) <= fileSize;
+
+    if (!valid)
+    {
+        errorMessage = INVALID_TILED_MAZE;
+        return false;
+    }
+
+    layout.nLines = nLines;
+    layout.nCols = nCols;
+    layout.hash = hash;
+    layout.tickInterval = chrono::milliseconds(tickInterval);
+    layout.player = Entity(player % nCols, player / nCols);
+    for (uint64_t robot : robots)
+        layout.robots.push_back(Entity(robot % nCols, robot / nCols));
+    layout.tiles = move(tiles);
+
+    return true;
+}
+
+/**
+ * This struct holds the layouts of the mazes being played, so they are only read once.
+ */
+struct LayoutCache
+{
+    /** Protects the layouts, games may be loaded from many threads */
+    mutex lock;
+    /** The layouts, by maze number. Forgotten when no game uses them anymore */
+    map<string, weak_ptr<const MazeLayout>> layouts;
+};
+
+/**
+ * Gets the cache of maze layouts.
+ * 
+ * @returns The cache
+ */
+LayoutCache &layoutCache()
+{
+    static LayoutCache cache;
+    return cache;
+}
+
+/**
+ * Gets the layout of a maze, reading its file only if no game is using it already. 
+ * The layout is shared by every game on the maze until the file changes. 
+ * The tiled file is used if there is one, see tileCommand, unless the text file was changed after it was made.
+ * 
+ * @param mazeNumber The maze number (in the range "01" to "99")
+ * @param errorMessage The reason why the file is invalid
+ * 
+ * @returns The layout, nullptr if the maze could not be read
+ */
+shared_ptr<const MazeLayout> loadMazeLayout(const string &mazeNumber, string &errorMessage)
+{
+    LayoutCache &cache = layoutCache();
+
+    error_code textError, tiledError;
+    auto textModified = filesystem::last_write_time("MAZE_"s + mazeNumber + ".txt"s, textError);
+    auto tiledModified = filesystem::last_write_time(tiledMazeFileName(mazeNumber), tiledError);
+
+    // A tiled file older than the text file is out of date, the text file is played instead
+    const bool tiled = !tiledError && (textError || textModified <= tiledModified);
+    const bool error = !tiled && textError;
+    auto modified = tiled ? tiledModified : textModified;
+
+    lock_guard<mutex> lock(cache.lock);
+
+    shared_ptr<const MazeLayout> layout = cache.layouts[mazeNumber].lock();
+    if (layout && !error && layout->modified == modified && bool(layout->tiles) == tiled)
+        return layout;
+
+    auto newLayout = make_shared<MazeLayout>();
+    newLayout->modified = modified;
+
+    if (!(tiled ? readTiledLayout(mazeNumber, *newLayout, errorMessage) : readMazeLayout(mazeNumber, *newLayout, errorMessage)))
+        return nullptr;
+
+    cache.layouts[mazeNumber] = newLayout;
+    return newLayout;
+}
+
+/**
+ * Finds the layout of a maze if a game is already using it, without reading the file.
+ * 
+ * @param mazeNumber The maze number (in the range "01" to "99")
+ * @param hash The hash the layout must have
+ * 
+ * @returns The layout, nullptr if no game is using it
+ */
+shared_ptr<const MazeLayout> findMazeLayout(const string &mazeNumber, const uint64_t hash)
+{
+    LayoutCache &cache = layoutCache();
+    lock_guard<mutex> lock(cache.lock);
+
+    auto found = cache.layouts.find(mazeNumber);
+    if (found == cache.layouts.end())
+        return nullptr;
+
+    shared_ptr<const MazeLayout> layout = found->second.lock();
+    return layout && layout->hash == hash ? layout : nullptr;
+}
+
+/**
+ * Finds which robot is in each cell, must be done whenever robots are changed other than by moveRobots.
+ * 
+ * @param maze The maze
+ */
+void indexRobots(Maze &maze)
+{
+    maze.robotCells.clear();
+    maze.robotCells.reserve(maze.robots.size());
+    for (size_t i = 0; i < maze.robots.size(); i++)
+        maze.robotCells[maze.index(maze.robots[i].column, maze.robots[i].line)] = i;
+}
+
+/**
+ * Starts a game on a maze: the maze's layout is shared, only the robots and the player are copied.
+ * 
+ * @param maze The game
+ * @param layout The maze's layout
+ */
+void startGame(Maze &maze, shared_ptr<const MazeLayout> layout)
+{
+    maze.nLines = layout->nLines;
+    maze.nCols = layout->nCols;
+    maze.robots = layout->robots;
+    maze.player = layout->player;
+    maze.layout = move(layout);
+    indexRobots(maze);
+}
+
+/**
+ * Converts a maze number to an integer, for trace events.
+ * 
+ * @param mazeNumber The maze number (in the range "01" to "99")
+ * @returns The number, 0 if it's not valid
+ */
+uint32_t mazeNumberValue(const string &mazeNumber)
+{
+    return validMazeNumber(mazeNumber) ? stoul(mazeNumber) : 0;
+}
+
+/**
+ * Loads a maze from the respective file. 
+ * Tries to handle invalid files.
+ * 
+ * @param maze The maze
+ * @param validInput Whether the last input was valid. Set to false if file is invalid
+ * @param errorMessage The reason why the file is invalid
+ * 
+ * @returns false if the maze was not loaded
+ */
+bool loadMaze(Maze &maze, bool &validInput, string &errorMessage)
+{
+    shared_ptr<const MazeLayout> layout = loadMazeLayout(maze.mazeNumber, errorMessage);
+
+    if (!layout)
+    {
+        traceEvent(TraceEventType::mazeLoad, false, mazeNumberValue(maze.mazeNumber));
+        validInput = false;
+        return false;
+    }
+
+    traceEvent(TraceEventType::mazeLoad, true, mazeNumberValue(maze.mazeNumber), layout->hash, layout->robots.size());
+    startGame(maze, move(layout));
+    return true;
+}
+
+/**
+ * Gets the name of the file where a game in progress on a maze is saved.
+ * 
+ * @param mazeNumber The maze number (in the range "01" to "99")
+ * @returns The file name
+ */
+string saveFileName(const string &mazeNumber)
+{
+    return "MAZE_"s + mazeNumber + "_SAVE.bin"s;
+}
+
+/**
+ * Appends the bytes of a value to a buffer.
+ * 
+ * @param buffer The buffer
+ * @param value The value
+ */
+template <typename T>
+void appendValue(vector<char> &buffer, const T &value)
+{
+    const char *bytes = reinterpret_cast<const char *>(&value);
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+/**
+ * Reads a value from a buffer and advances the read position.
+ * 
+ * @param position Where to read from, moved past the value
+ * @param end The end of the buffer
+ * @param value Where to store the value
+ * 
+ * @returns false if the buffer is too short
+ */
+template <typename T>
+bool readValue(const char *&position, const char *end, T &value)
+{
+    if (end - position < static_cast<ptrdiff_t>(sizeof(T)))
+        return false;
+
+    copy(position, position + sizeof(T), reinterpret_cast<char *>(&value));
+    position += sizeof(T);
+    return true;
+}
+
+/**
+ * Gets how long the player has been playing.
+ * 
+ * @param maze The maze
+ * @returns The time since the game started
+ */
+chrono::milliseconds elapsedTime(const Maze &maze)
+{
+    return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - maze.startTime);
+}
+
+/**
+ * Gets the name of the file where the fences of a saved game's maze are kept, see saveFences.
+ * 
+ * @param mazeNumber The maze number (in the range "01" to "99")
+ * @returns The file name
+ */
+string saveFencesFileName(const string &mazeNumber)
+{
+    return saveFileName(mazeNumber) + ".fences"s;
+}
+
+/**
+ * Creates the header of a saved game's fences file: the maze's hash and size.
+ * 
+ * @param hash The maze's hash
+ * @param nLines The maze's number of lines
+ * @param nCols The maze's number of columns
+ * @param buffer Where the header is stored
+ */
+void fencesHeader(uint64_t hash, uint64_t nLines, uint64_t nCols, vector<char> &buffer)
+{
+    buffer.assign(SAVE_FENCES_MAGIC.begin(), SAVE_FENCES_MAGIC.end());
+    appendValue(buffer, hash);
+    appendValue(buffer, nLines);
+    appendValue(buffer, nCols);
+}
+
+/**
+ * Saves the fences of a game's maze next to its save, so it can be resumed even if the maze file changes. 
+ * Fences never change during a game, so the file is only written when it has a different maze. 
+ * Tiled mazes keep their fences in their tiled file.
+ * 
+ * @param maze The maze
+ */
+void saveFences(const Maze &maze)
+{
+    if (maze.layout->tiles)
+        return;
+
+    const size_t cells = maze.nLines * maze.nCols;
+    string fileName = saveFencesFileName(maze.mazeNumber);
+
+    vector<char> buffer;
+    fencesHeader(maze.layout->hash, maze.nLines, maze.nCols, buffer);
+
+    // Already saved for this maze
+    vector<char> saved(buffer.size());
+    ifstream savedFile(fileName, ios::binary);
+    if (savedFile.read(saved.data(), saved.size()) && saved == buffer)
+        return;
+    savedFile.close();
+
+    // Fences, 8 cells per byte
+    size_t bitsStart = buffer.size();
+    buffer.resize(bitsStart + (cells + 7) / 8, 0);
+    for (size_t i = 0; i < cells; i++)
+    {
+        if (maze.layout->fenceMap[i] == '*')
+            buffer[bitsStart + i / 8] |= 1 << (i % 8);
+    }
+
+    string tempFileName = fileName + ".tmp"s;
+
+    ofstream file(tempFileName, ios::binary);
+    file.write(buffer.data(), buffer.size());
+    file.close();
+
+    if (file.good())
+    {
+        error_code error;
+        filesystem::rename(tempFileName, fileName, error);
+    }
+}
+
+/**
+ * Reads the fences of a saved game's maze, saved by saveFences.
+ * 
+ * @param mazeNumber The maze number (in the range "01" to "99")
+ * @param layout Where the fences are stored, its hash and size must already be set
+ * 
+ * @returns false if they weren't saved or were saved for a different maze
+ */
+bool readSavedFences(const string &mazeNumber, MazeLayout &layout)
+{
+    const size_t cells = layout.nLines * layout.nCols;
+
+    vector<char> header;
+    fencesHeader(layout.hash, layout.nLines, layout.nCols, header);
+
+    ifstream file(saveFencesFileName(mazeNumber), ios::binary);
+    vector<char> buffer(header.size() + (cells + 7) / 8);
+    if (!file.read(buffer.data(), buffer.size()) || file.peek() != EOF ||
+        !equal(header.begin(), header.end(), buffer.begin()))
+        return false;
+
+    layout.fenceMap.resize(cells);
+    for (size_t i = 0; i < cells; i++)
+        layout.fenceMap[i] = (buffer[header.size() + i / 8] >> (i % 8)) & 1 ? '*' : ' ';
+    return true;
+}
+
+/**
+ * Serializes the state of a game into a compact binary snapshot:
+ * - A header with the maze number and size
+ * - The time played, the turn and the player
+ * - The maze's hash, whether it's tiled or has smart robots, its tick interval and the moves played, encoded with encodeMoves
+ * - The robots' positions, as map indices, followed by one alive bit per robot
+ * 
+ * The fences aren't part of the snapshot, they never change during a game and saveFences writes them once. 
+ * Snapshots from before version 4 have them after the moves, one bit per cell, unless the maze is tiled.
+ * 
+ * @param maze The maze
+ * @param buffer Where the snapshot is stored
+ */
+void serializeGame(const Maze &maze, vector<char> &buffer)
+{
+    const size_t cells = maze.nLines * maze.nCols;
+    const bool wideIndices = cells > UINT32_MAX;
+    const bool tiled = maze.layout->tiles != nullptr;
+
+    buffer.clear();
+    buffer.reserve(64 + maze.moves.size() + maze.robots.size() * (wideIndices ? 8 : 4) + maze.robots.size() / 8);
+
+    buffer.insert(buffer.end(), SAVE_MAGIC.begin(), SAVE_MAGIC.end());
+    appendValue(buffer, SAVE_VERSION);
+    buffer.insert(buffer.end(), maze.mazeNumber.begin(), maze.mazeNumber.end());
+    appendValue<uint64_t>(buffer, maze.nLines);
+    appendValue<uint64_t>(buffer, maze.nCols);
+    appendValue<uint64_t>(buffer, elapsedTime(maze).count());
+    appendValue<uint64_t>(buffer, maze.turn);
+    appendValue<uint64_t>(buffer, maze.index(maze.player.column, maze.player.line));
+    appendValue<uint8_t>(buffer, maze.player.alive);
+    appendValue<uint64_t>(buffer, maze.robots.size());
+    appendValue<uint64_t>(buffer, maze.layout->hash);
+    appendValue<uint8_t>(buffer, (tiled ? SAVE_TILED : 0) | (maze.layout->smartRobots ? SAVE_SMART_ROBOTS : 0));
+    appendValue<uint64_t>(buffer, maze.layout->tickInterval.count());
+
+    string moves = encodeMoves(maze.moves);
+    appendValue<uint64_t>(buffer, moves.length());
+    buffer.insert(buffer.end(), moves.begin(), moves.end());
+
+    // Robot positions, 4 bytes each unless the maze is huge
+    for (const Entity &robot : maze.robots)
+    {
+        size_t index = maze.index(robot.column, robot.line);
+        if (wideIndices)
+            appendValue<uint64_t>(buffer, index);
+        else
+            appendValue<uint32_t>(buffer, index);
+    }
+
+    // Robots alive, 8 robots per byte
+    size_t bitsStart = buffer.size();
+    buffer.resize(bitsStart + (maze.robots.size() + 7) / 8, 0);
+    for (size_t i = 0; i < maze.robots.size(); i++)
+    {
+        if (maze.robots[i].alive)
+            buffer[bitsStart + i / 8] |= 1 << (i % 8);
+    }
+}
+
+/**
+ * Restores the state of a game from a snapshot created by serializeGame. 
+ * The maze is rebuilt from the snapshot and the fences saved by saveFences, its text is only read again if it's tiled.
+ * 
+ * @param buffer The snapshot
+ * @param maze Where the game is restored to
+ * 
+ * @returns false if the snapshot is invalid
+ */
+bool deserializeGame(const vector<char> &buffer, Maze &maze)
+{
+    const char *position = buffer.data();
+    const char *end = position + buffer.size();
+
+    if (buffer.size() < SAVE_MAGIC.length() + 3 || !equal(SAVE_MAGIC.begin(), SAVE_MAGIC.end(), position))
+        return false;
+    position += SAVE_MAGIC.length();
+
+    uint8_t version;
+    uint64_t nLines, nCols, elapsed, turn, player, nRobots, hash, movesLength, tickInterval = 0;
+    uint8_t playerAlive, flags = 0;
+
+    // Saves from before tiled mazes are still read
+    if (!readValue(position, end, version) || version < 2 || version > SAVE_VERSION)
+        return false;
+
+    maze.mazeNumber.assign(position, 2);
+    position += 2;
+
+    if (!readValue(position, end, nLines) || !readValue(position, end, nCols) ||
+        !readValue(position, end, elapsed) || !readValue(position, end, turn) ||
+        !readValue(position, end, player) || !readValue(position, end, playerAlive) ||
+        !readValue(position, end, nRobots) || !readValue(position, end, hash) ||
+        (version > 2 && (!readValue(position, end, flags) || !readValue(position, end, tickInterval) || tickInterval == 0)) ||
+        !readValue(position, end, movesLength) || static_cast<uint64_t>(end - position) < movesLength)
+        return false;
+
+    if (!decodeMoves(string(position, movesLength), maze.moves, turn) || countTurns(maze.moves) != turn)
+        return false;
+    position += movesLength;
+
+    const size_t cells = nLines * nCols;
+    const bool wideIndices = cells > UINT32_MAX;
+    const bool tiled = flags & SAVE_TILED;
+    const size_t fenceBytes = tiled || version > 3 ? 0 : (cells + 7) / 8;
+    const size_t robotBytes = nRobots * (wideIndices ? 8 : 4) + (nRobots + 7) / 8;
+
+    if (player >= cells || static_cast<size_t>(end - position) != fenceBytes + robotBytes)
+        return false;
+
+    maze.nLines = nLines;
+    maze.nCols = nCols;
+    maze.turn = turn;
+    maze.startTime = chrono::steady_clock::now() - chrono::milliseconds(elapsed);
+    maze.player = Entity(player % nCols, player / nCols);
+    maze.player.alive = playerAlive;
+
+    // Share the layout if another game is using it, the maze text is only read again for tiled mazes
+    maze.layout = findMazeLayout(maze.mazeNumber, hash);
+    if (!maze.layout && tiled)
+    {
+        string errorMessage;
+        maze.layout = loadMazeLayout(maze.mazeNumber, errorMessage);
+    }
+
+    if (!maze.layout || maze.layout->hash != hash || maze.layout->nLines != nLines || maze.layout->nCols != nCols)
+    {
+        // The fences of tiled mazes stay in their tiled file
+        if (tiled)
+            return false;
+
+        // Play the maze in the snapshot, even if its file changed since
+        auto layout = make_shared<MazeLayout>();
+        layout->nLines = nLines;
+        layout->nCols = nCols;
+        layout->hash = hash;
+        layout->smartRobots = flags & SAVE_SMART_ROBOTS;
+        layout->tickInterval = tickInterval ? chrono::milliseconds(tickInterval) : DEFAULT_TICK_INTERVAL;
+        if (version > 3)
+        {
+            if (!readSavedFences(maze.mazeNumber, *layout))
+                return false;
+        }
+        else
+        {
+            layout->fenceMap.resize(cells);
+            for (size_t i = 0; i < cells; i++)
+                layout->fenceMap[i] = (position[i / 8] >> (i % 8)) & 1 ? '*' : ' ';
+        }
+        indexFences(*layout);
+        maze.layout = move(layout);
+    }
+    else if (tickInterval && maze.layout->tickInterval != chrono::milliseconds(tickInterval))
+    {
+        // Only the maze's tick interval changed, keep the one the game was played with
+        auto layout = make_shared<MazeLayout>(*maze.layout);
+        layout->tickInterval = chrono::milliseconds(tickInterval);
+        maze.layout = move(layout);
+    }
+    position += fenceBytes;
+
+    maze.robots.clear();
+    maze.robots.reserve(nRobots);
+    for (size_t i = 0; i < nRobots; i++)
+    {
+        uint64_t index = 0;
+        if (wideIndices)
+            readValue(position, end, index);
+        else
+        {
+            uint32_t narrowIndex = 0;
+            readValue(position, end, narrowIndex);
+            index = narrowIndex;
+        }
+
+        if (index >= cells)
+            return false;
+
+        maze.robots.push_back(Entity(index % nCols, index / nCols));
+    }
+
+    for (size_t i = 0; i < nRobots; i++)
+        maze.robots[i].alive = (position[i / 8] >> (i % 8)) & 1;
+
+    indexRobots(maze);
+    return true;
+}
+
+/**
+ * Saves a game in progress so it can be resumed later. 
+ * The snapshot is written to a temporary file with a single call and then renamed,
+ * so a crash while saving never leaves a broken save behind.
+ * 
+ * @param maze The maze
+ */
+void saveGame(const Maze &maze)
+{
+    // Before the snapshot, so there's never a snapshot without its fences
+    saveFences(maze);
+
+    // Reused between saves to avoid allocating every time
+    static vector<char> buffer;
+    serializeGame(maze, buffer);
+
+    string fileName = saveFileName(maze.mazeNumber);
+    string tempFileName = fileName + ".tmp"s;
+
+    ofstream file(tempFileName, ios::binary);
+    file.write(buffer.data(), buffer.size());
+    file.close();
+
+    if (file.good())
+    {
+        error_code error;
+        filesystem::rename(tempFileName, fileName, error);
+    }
+}
+
+/**
+ * Resumes a saved game.
+ * 
+ * @param maze The maze, mazeNumber must already be set
+ * 
+ * @returns false if there's no valid save for this maze
+ */
+bool resumeGame(Maze &maze)
+{
+    ifstream file(saveFileName(maze.mazeNumber), ios::binary);
+
+    // File doesn't exist
+    if (!file.is_open())
+        return false;
+
+    vector<char> buffer;
+    file.seekg(0, ios::end);
+    buffer.resize(file.tellg());
+    file.seekg(0, ios::beg);
+    file.read(buffer.data(), buffer.size());
+
+    string mazeNumber = maze.mazeNumber;
+    if (!file || !deserializeGame(buffer, maze) || maze.mazeNumber != mazeNumber)
+    {
+        // Don't leave a half restored maze behind
+        maze = Maze();
+        maze.mazeNumber = mazeNumber;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Gets the name of the file where the games played on a maze are recorded.
+ * 
+ * @param mazeNumber The maze number (in the range "01" to "99")
+ * @returns The file name
+ */
+string gameLogFileName(const string &mazeNumber)
+{
+    return "MAZE_"s + mazeNumber + "_GAMES.log"s;
+}
+
+/**
+ * Adds games to a maze's game log, one line per game with the maze's hash and the moves, like leaderboard proofs.
+ * 
+ * @param mazeNumber The maze number (in the range "01" to "99")
+ * @param records The games
+ */
+void recordGames(const string &mazeNumber, const vector<GameRecord> &records)
+{
+    ofstream file(gameLogFileName(mazeNumber), ios::app);
+
+    for (const GameRecord &record : records)
+        file << setw(16) << setfill('0') << hex << record.mazeHash << dec << setfill(' ') << ' ' << record.moves << '\n';
+}
+
+/**
+ * Adds a game that ended to its maze's game log, for --analyze.
+ * 
+ * @param maze The maze
+ */
+void recordGame(const Maze &maze)
+{
+    recordGames(maze.mazeNumber, {{maze.layout->hash, encodeMoves(maze.moves)}});
+}
+
+/**
+ * Reads the next game of a maze's game log.
+ * 
+ * @param file The game log
+ * @param record Where the game is stored
+ * 
+ * @returns false if there are no more games
+ */
+bool readGameRecord(istream &file, GameRecord &record)
+{
+    string line;
+    while (getline(file, line))
+    {
+        stringstream linestream(line);
+
+        // Games that ended before any move have no moves
+        if (linestream >> hex >> record.mazeHash)
+        {
+            record.moves.clear();
+            linestream >> record.moves;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Deletes the save of a maze, if there is one.
+ * 
+ * @param mazeNumber The maze number (in the range "01" to "99")
+ */
+void deleteSave(const string &mazeNumber)
+{
+    error_code error;
+    filesystem::remove(saveFileName(mazeNumber), error);
+    filesystem::remove(saveFencesFileName(mazeNumber), error);
+}
+
+/**
+ * Sets aside the save of a maze that can't be resumed, so the player isn't offered it again. 
+ * It is kept with a ".damaged" extension instead of being deleted, in case someone wants to look at it.
+ * 
+ * @param mazeNumber The maze number (in the range "01" to "99")
+ */
+void setAsideSave(const string &mazeNumber)
+{
+    error_code error;
+    filesystem::rename(saveFileName(mazeNumber), saveFileName(mazeNumber) + ".damaged"s, error);
+    filesystem::remove(saveFencesFileName(mazeNumber), error);
+}
+
+/**
+ * Receives input from the player and loads the respective maze.
+ * 
+ * @param gameState The game state
+ * @param maze Where the maze is stored
+ * @param realTime Whether the game is played in real time
+ * 
+ * @returns false if the player wants to exit the game
+ */
+bool mazeMenu(GameState &gameState, Maze &maze, bool realTime, bool &validInput, string &errorMessage)
+{
+    // Reset maze variable
+    maze = Maze();
+    maze.realTime = realTime;
+
+    validInput = true;
+
+    // Ask user for input
+    cout << "Input number of the maze: ";
 
     // Get input
     if (!getInput(maze.mazeNumber))
         return false;
 
-    // Pad out maze number
-    // "" -> "0" -> "00"
-    // "5" -> "05"
-    while (maze.mazeNumber.length() < 2)
+    // Pad out maze number
+    // "" -> "0" -> "00"
+    // "5" -> "05"
+    while (maze.mazeNumber.length() < 2)
+    {
+        maze.mazeNumber = "0"s + maze.mazeNumber;
+    }
+
+    // User wants to return to main menu
+    if (maze.mazeNumber == "00")
+    {
+        cout << "\n";
+        gameState = GameState::mainMenu;
+        return true;
+    }
+
+    // Maze number is invalid
+    if (!validMazeNumber(maze.mazeNumber))
+    {
+        validInput = false;
+        errorMessage = INVALID_MAZE_NUMBER;
+        return true;
+    }
+
+    // Resume a saved game if the user wants to
+    if (filesystem::exists(saveFileName(maze.mazeNumber)))
+    {
+        string decision;
+        while (true)
+        {
+            cout << SAVE_FOUND;
+
+            if (!getInput(decision))
+                return false;
+
+            if (decision.empty() || decision == "y" || decision == "Y" || decision == "n" || decision == "N")
+                break;
+
+            cout << GENERIC_ERROR << "\n\n";
+        }
+
+        if (decision != "n" && decision != "N")
+        {
+            if (resumeGame(maze))
+            {
+                maze.realTime = realTime;
+                gameState = GameState::inGame;
+                return true;
+            }
+
+            // Otherwise it would be offered again every time
+            cout << DAMAGED_SAVE << "\n\n";
+            setAsideSave(maze.mazeNumber);
+        }
+    }
+
+    if (!loadMaze(maze, validInput, errorMessage))
+    {
+        return true;
+    }
+
+    // Start the game
+    gameState = GameState::inGame;
+    maze.startTime = chrono::steady_clock::now();
+    return true;
+}
+
+/**
+ * Gets the number of the tile a cell of a tiled maze is in.
+ * 
+ * @param tiles The maze's tiles
+ * @param column The cell's column
+ * @param line The cell's line
+ * 
+ * @returns The tile number
+ */
+size_t tileNumber(const TileStore &tiles, const size_t column, const size_t line)
+{
+    return line / TILE_SIZE * tiles.tileCols + column / TILE_SIZE;
+}
+
+/**
+ * Checks if a cell of a tiled maze is a fence/post, reading its tile if it isn't in memory. 
+ * When too many tiles are in memory, the one used longest ago is forgotten. 
+ * Each thread also keeps its own copy of the tiles it used last, only the others lock the maze's tiles.
+ * 
+ * @param tiles The maze's tiles
+ * @param column The cell's column
+ * @param line The cell's line
+ * 
+ * @returns true if the cell is a fence/post
+ */
+bool tileFence(TileStore &tiles, const size_t column, const size_t line)
+{
+    const size_t tile = tileNumber(tiles, column, line);
+    if (tiles.offsets[tile] == 0)
+        return false;
+
+    static thread_local vector<ThreadTile> threadTiles(THREAD_TILE_CACHE_SIZE);
+
+    ThreadTile &own = threadTiles[tile % THREAD_TILE_CACHE_SIZE];
+    if (own.store == tiles.id && own.tile == tile)
+        return (own.rows[line % TILE_SIZE] >> (column % TILE_SIZE)) & 1;
+
+    lock_guard<mutex> lock(tiles.lock);
+
+    auto cached = tiles.cache.find(tile);
+    if (cached != tiles.cache.end())
+        tiles.recent.splice(tiles.recent.begin(), tiles.recent, cached->second.age);
+    else
+    {
+        if (tiles.cache.size() >= TILE_CACHE_SIZE)
+        {
+            tiles.cache.erase(tiles.recent.back());
+            tiles.recent.pop_back();
+        }
+
+        tiles.recent.push_front(tile);
+        cached = tiles.cache.emplace(tile, CachedTile()).first;
+        CachedTile &newTile = cached->second;
+        newTile.age = tiles.recent.begin();
+
+        tiles.file.clear();
+        tiles.file.seekg(tiles.offsets[tile]);
+        tiles.file.read(reinterpret_cast<char *>(newTile.rows.data()), sizeof(newTile.rows));
+
+        // A tile that can't be read is all fences, nothing can get lost in it
+        if (!tiles.file)
+            newTile.rows.fill(UINT64_MAX);
+    }
+
+    own.store = tiles.id;
+    own.tile = tile;
+    own.rows = cached->second.rows;
+
+    return (own.rows[line % TILE_SIZE] >> (column % TILE_SIZE)) & 1;
+}
+
+/**
+ * Checks if there's a fence/post in a cell.
+ * 
+ * @param maze The maze
+ * @param column The column
+ * @param line The line
+ * 
+ * @returns true if there's a fence in the cell
+ */
+bool isFence(const Maze &maze, const size_t column, const size_t line)
+{
+    if (maze.layout->tiles)
+        return tileFence(*maze.layout->tiles, column, line);
+
+    return maze.layout->fenceMap[maze.index(column, line)] == '*';
+}
+
+/**
+ * Finds a robot in a cell. 
+ * If there are many, they are all dead.
+ * 
+ * @param maze The maze
+ * @param column The column
+ * @param line The line
+ * 
+ * @returns The robot, nullptr if there's no robot in the cell
+ */
+const Entity *robotAt(const Maze &maze, const size_t column, const size_t line)
+{
+    auto found = maze.robotCells.find(maze.index(column, line));
+    return found == maze.robotCells.end() ? nullptr : &maze.robots[found->second];
+}
+
+/**
+ * Does a player move if it is valid.
+ * If it's not, returns a useful error message.
+ * 
+ * @param maze The maze
+ * @param errorMessage The error message returned if the movement is invalid
+ * @param columnDelta How many cells to move in the x axis
+ * @param lineDelta How many cells to move in the y axis
+ * 
+ * @returns false if the movement is invalid
+ */
+bool doPlayerMove(Maze &maze, string &errorMessage, int columnDelta, int lineDelta)
+{
+    int newCol = maze.player.column + columnDelta;
+    int newLine = maze.player.line + lineDelta;
+
+    if (newCol < 0 || newCol >= maze.nCols || newLine < 0 || newLine >= maze.nLines)
+    {
+        errorMessage = OUT_OF_BOUNDS;
+        return false;
+    }
+    // Dead robots block the way, moving onto a live one is deadly
+    const Entity *robot = robotAt(maze, newCol, newLine);
+    if (robot && !robot->alive)
+    {
+        errorMessage = CELL_OCCUPIED;
+        return false;
+    }
+
+    maze.player.column = newCol;
+    maze.player.line = newLine;
+    return true;
+}
+
+/**
+ * Stores the current state as a keyframe if one is due.
+ * Should be called before each turn is played.
+ * 
+ * @param maze The maze
+ */
+void recordKeyframe(Maze &maze)
+{
+    History &history = maze.history;
+
+    if (history.turns.size() == history.keyframes.size() * KEYFRAME_INTERVAL)
+        history.keyframes.push_back({maze.player, maze.robots});
+}
+
+/**
+ * Finishes a turn's delta and stores it in the history. 
+ * A robot may have been changed more than once during the turn, only its first previous state is kept.
+ * 
+ * @param maze The maze
+ * @param delta The turn, with the previous state of every robot that changed
+ */
+void recordTurn(Maze &maze, TurnDelta &delta)
+{
+    stable_sort(delta.robots.begin(), delta.robots.end(), [](const RobotChange &c1, const RobotChange &c2)
+                { return c1.robot < c2.robot; });
+
+    auto last = unique(delta.robots.begin(), delta.robots.end(), [](const RobotChange &c1, const RobotChange &c2)
+                       { return c1.robot == c2.robot; });
+    delta.robots.erase(last, delta.robots.end());
+
+    for (RobotChange &change : delta.robots)
+        change.after = maze.robots.at(change.robot);
+    delta.playerAfter = maze.player;
+
+    maze.history.turns.push_back(move(delta));
+}
+
+/**
+ * Goes back a number of turns. 
+ * Either undoes the turns one by one or replays them from the closest keyframe, whichever changes fewer entities.
+ * 
+ * @param maze The maze
+ * @param count How many turns to go back
+ * @param errorMessage The error message returned if it's not possible to go back that far
+ * 
+ * @returns false if it's not possible to go back that far
+ */
+bool rewind(Maze &maze, size_t count, string &errorMessage)
+{
+    History &history = maze.history;
+    const size_t current = history.turns.size();
+
+    if (count == 0 || count > current)
+    {
+        errorMessage = current == 0 ? NOTHING_TO_UNDO : CANNOT_UNDO_THAT_MUCH;
+        return false;
+    }
+
+    const size_t target = current - count;
+    const size_t keyframe = target / KEYFRAME_INTERVAL;
+
+    size_t backwardCost = 0;
+    for (size_t i = target; i < current; i++)
+        backwardCost += history.turns[i].robots.size() + 1;
+
+    size_t forwardCost = maze.robots.size();
+    for (size_t i = keyframe * KEYFRAME_INTERVAL; i < target && forwardCost < backwardCost; i++)
+        forwardCost += history.turns[i].robots.size() + 1;
+
+    if (forwardCost < backwardCost)
+    {
+        // Replay from the keyframe
+        maze.player = history.keyframes.at(keyframe).player;
+        maze.robots = history.keyframes.at(keyframe).robots;
+
+        for (size_t i = keyframe * KEYFRAME_INTERVAL; i < target; i++)
+        {
+            for (const RobotChange &change : history.turns[i].robots)
+                maze.robots[change.robot] = change.after;
+            maze.player = history.turns[i].playerAfter;
+        }
+    }
+    else
+    {
+        // Undo turn by turn
+        for (size_t i = current; i-- > target;)
+        {
+            for (const RobotChange &change : history.turns[i].robots)
+                maze.robots[change.robot] = change.before;
+            maze.player = history.turns[i].playerBefore;
+        }
+    }
+
+    size_t turns = 0;
+    for (size_t i = target; i < current; i++)
+        turns += history.turns[i].turns;
+
+    history.turns.resize(target);
+    history.keyframes.resize(keyframe + 1);
+    maze.turn -= turns;
+    maze.moves.resize(maze.moves.length() - turns);
+    indexRobots(maze);
+
+    return true;
+}
+
+/**
+ * Checks if two entities occupy the same cell.
+ * 
+ * @param e1 The first entity
+ * @param e2 The second entity
+ * 
+ * @returns true if the entities collided
+ */
+bool entityEntityCollision(const Entity &e1, const Entity &e2)
+{
+    return e1.line == e2.line && e1.column == e2.column;
+}
+
+/**
+ * Checks if an entity occupies the same cell as a fence.
+ * 
+ * @param entity The entity
+ * @param maze The second entity
+ * 
+ * @returns true if the entities collided
+ */
+bool entityFenceCollision(const Entity &entity, const Maze &maze)
+{
+    return isFence(maze, entity.column, entity.line);
+}
+
+/**
+ * Starts a new distance field from a cell. 
+ * Nothing is computed yet, distances are found as they're needed by flowDistance.
+ * 
+ * @param field The distance field
+ * @param maze The maze
+ * @param source The cell distances are measured to
+ */
+void resetFlowField(FlowField &field, const Maze &maze, const size_t source)
+{
+    const size_t cells = maze.nLines * maze.nCols;
+    if (field.stamp.size() != cells)
+    {
+        field.stamp.assign(cells, 0);
+        field.distance.resize(cells);
+        field.generation = 0;
+    }
+
+    // Bumping the generation forgets every distance without touching them
+    field.generation++;
+    if (field.generation == 0)
+    {
+        fill(field.stamp.begin(), field.stamp.end(), 0);
+        field.generation = 1;
+    }
+
+    field.source = source;
+    field.queue.clear();
+    field.queueFront = 0;
+
+    field.stamp[source] = field.generation;
+    field.distance[source] = 0;
+    field.queue.push_back(source);
+}
+
+/**
+ * Gets how many moves it takes to go from a cell to the field's source without crossing fences. 
+ * The breadth first search only goes as far as needed and continues where it stopped on the next call.
+ * 
+ * @param field The distance field
+ * @param maze The maze
+ * @param cell The cell
+ * 
+ * @returns The distance, UINT32_MAX if the source can't be reached
+ */
+uint32_t flowDistance(FlowField &field, const Maze &maze, const size_t cell)
+{
+    while (field.stamp[cell] != field.generation && field.queueFront < field.queue.size())
+    {
+        const size_t current = field.queue[field.queueFront++];
+        const size_t column = current % maze.nCols, line = current / maze.nCols;
+
+        for (size_t l = line ? line - 1 : line; l <= line + 1 && l < maze.nLines; l++)
+        {
+            for (size_t c = column ? column - 1 : column; c <= column + 1 && c < maze.nCols; c++)
+            {
+                const size_t next = maze.index(c, l);
+                if (field.stamp[next] == field.generation || isFence(maze, c, l))
+                    continue;
+
+                field.stamp[next] = field.generation;
+                field.distance[next] = field.distance[current] + 1;
+                field.queue.push_back(next);
+            }
+        }
+    }
+
+    return field.stamp[cell] == field.generation ? field.distance[cell] : UINT32_MAX;
+}
+
+/**
+ * Finds where a robot steps next. 
+ * Robots step straight towards the player, unless the maze has smart robots, 
+ * which follow the shortest path around fences when there is one.
+ * 
+ * @param maze The maze
+ * @param robot The robot
+ * @param columnDelta Where the step on the x-axis is stored
+ * @param lineDelta Where the step on the y-axis is stored
+ */
+void robotStep(Maze &maze, const Entity &robot, int &columnDelta, int &lineDelta)
+{
+    columnDelta = sign(long(maze.player.column) - long(robot.column));
+    lineDelta = sign(long(maze.player.line) - long(robot.line));
+
+    if (!maze.layout->smartRobots)
+        return;
+
+    const FlowField &field = maze.flowField;
+    const uint32_t distance = flowDistance(maze.flowField, maze, maze.index(robot.column, robot.line));
+    if (distance == UINT32_MAX || distance == 0)
+        return;
+
+    // The search found every cell closer than the robot before reaching it, so the neighbours are only looked up. 
+    // Searching on from them would go on through the whole maze whenever one is a fence
+    auto isStepTowards = [&](const long column, const long line)
+    {
+        if (column < 0 || line < 0 || size_t(column) >= maze.nCols || size_t(line) >= maze.nLines || isFence(maze, column, line))
+            return false;
+
+        const size_t cell = maze.index(column, line);
+        return field.stamp[cell] == field.generation && field.distance[cell] == distance - 1;
+    };
+
+    // The straight step is tried first, so robots only turn when they must
+    if (isStepTowards(long(robot.column) + columnDelta, long(robot.line) + lineDelta))
+        return;
+
+    for (int l = -1; l <= 1; l++)
+    {
+        for (int c = -1; c <= 1; c++)
+        {
+            if (isStepTowards(long(robot.column) + c, long(robot.line) + l))
+            {
+                columnDelta = c;
+                lineDelta = l;
+                return;
+            }
+        }
+    }
+}
+
+/**
+ * Moves the robots that are alive in sequential order.
+ * Also checks for collisions between robots, robots and fences, and robots and the player.
+ * 
+ * @param maze The maze
+ * @param delta If not null, the previous state of every robot that changes is added to it
+ */
+void moveRobots(Maze &maze, TurnDelta *delta = nullptr)
+{
+    // Smart robots share the distances to the player, which only change when the player moves
+    const size_t playerCell = maze.index(maze.player.column, maze.player.line);
+    if (maze.layout->smartRobots && maze.flowField.source != playerCell)
+        resetFlowField(maze.flowField, maze, playerCell);
+
+    unordered_map<size_t, size_t> &occupied = maze.robotCells;
+
+    for (size_t robotIndex = 0; robotIndex < maze.robots.size(); robotIndex++)
+    {
+        Entity &robot = maze.robots[robotIndex];
+        if (!robot.alive)
+            continue;
+
+        if (delta)
+            delta->robots.push_back({robotIndex, robot});
+
+        int columnDelta, lineDelta;
+        robotStep(maze, robot, columnDelta, lineDelta);
+
+        // A robot that is alive is alone in its cell
+        occupied.erase(maze.index(robot.column, robot.line));
+
+        robot.line += lineDelta;
+        robot.column += columnDelta;
+
+        const size_t cell = maze.index(robot.column, robot.line);
+
+        robot.alive = !entityFenceCollision(robot, maze);
+        if (!robot.alive)
+            traceEvent(TraceEventType::robotDeath, uint8_t(DeathCause::fence), robotIndex, cell);
+
+        auto found = occupied.find(cell);
+        if (found != occupied.end())
+        {
+            const size_t otherIndex = found->second;
+            Entity &other = maze.robots[otherIndex];
+
+            if (delta && other.alive)
+                delta->robots.push_back({otherIndex, other});
+
+            if (robot.alive)
+                traceEvent(TraceEventType::robotDeath, uint8_t(DeathCause::robot), robotIndex, cell, otherIndex + 1);
+            if (other.alive)
+                traceEvent(TraceEventType::robotDeath, uint8_t(DeathCause::robot), otherIndex, cell, robotIndex + 1);
+
+            robot.alive = false;
+            other.alive = false;
+        }
+        else
+            occupied[cell] = robotIndex;
+
+        if (entityEntityCollision(robot, maze.player))
+        {
+            if (maze.player.alive)
+                traceEvent(TraceEventType::playerDeath, uint8_t(DeathCause::robot), maze.turn, cell);
+
+            maze.player.alive = false;
+        }
+    }
+}
+
+/**
+ * Moves the player and checks if they died, without moving the robots.
+ * 
+ * @param maze The maze
+ * @param move The movement key, in lower case
+ * @param errorMessage The error message returned if the movement is invalid
+ * 
+ * @returns false if the movement is invalid, in which case nothing happens
+ */
+bool stepPlayer(Maze &maze, const char move, string &errorMessage)
+{
+    int columnDelta, lineDelta;
+    if (!moveDelta(move, columnDelta, lineDelta))
+    {
+        errorMessage = GENERIC_ERROR;
+        return false;
+    }
+
+    if (!doPlayerMove(maze, errorMessage, columnDelta, lineDelta))
+        return false;
+
+    const size_t cell = maze.index(maze.player.column, maze.player.line);
+    traceEvent(TraceEventType::playerMove, move, maze.turn, cell);
+
+    const Entity *robot = robotAt(maze, maze.player.column, maze.player.line);
+    if (entityFenceCollision(maze.player, maze) || (robot && robot->alive))
+    {
+        traceEvent(TraceEventType::playerDeath, uint8_t(robot ? DeathCause::robot : DeathCause::fence), maze.turn, cell);
+        maze.player.alive = false;
+    }
+
+    return true;
+}
+
+/**
+ * Moves the robots on their own, in real time games.
+ * 
+ * @param maze The maze
+ */
+void tickRobots(Maze &maze)
+{
+    maze.turn++;
+    maze.moves += ROBOT_TICK;
+    moveRobots(maze);
+}
+
+/**
+ * Plays a whole turn: moves the player, checks if they died and moves the robots. 
+ * Doesn't print or read anything, so it can also be used by bots and tools.
+ * 
+ * @param maze The maze
+ * @param move The movement key, in lower case
+ * @param errorMessage The error message returned if the movement is invalid
+ * @param delta If not null, where the changes made during the turn are stored
+ * 
+ * @returns false if the movement is invalid, in which case nothing happens
+ */
+bool playTurn(Maze &maze, const char move, string &errorMessage, TurnDelta *delta = nullptr)
+{
+    if (!stepPlayer(maze, move, errorMessage))
+        return false;
+
+    maze.turn++;
+    maze.moves += move;
+
+    if (maze.player.alive)
+        moveRobots(maze, delta);
+
+    return true;
+}
+
+/**
+ * Replays something that happened in a game:
+ * - A movement key in lower case is a whole turn
+ * - A movement key in upper case is the player moving on their own, in real time games
+ * - ROBOT_TICK is the robots moving on their own, in real time games
+ * 
+ * @param maze The maze
+ * @param move What happened
+ * @param errorMessage The error message returned if it's not possible
+ * 
+ * @returns false if it's not possible
+ */
+bool replayMove(Maze &maze, const char move, string &errorMessage)
+{
+    if (move == ROBOT_TICK)
+    {
+        tickRobots(maze);
+        return true;
+    }
+
+    if (isupper(static_cast<unsigned char>(move)))
+    {
+        if (!stepPlayer(maze, tolower(static_cast<unsigned char>(move)), errorMessage))
+            return false;
+
+        maze.moves += move;
+        return true;
+    }
+
+    return playTurn(maze, move, errorMessage);
+}
+
+/**
+ * Checks if the game has ended, either because all robots are dead or because the player is dead.
+ * 
+ * @param maze The maze
+ * 
+ * @returns true if the game is over
+ */
+bool isGameOver(const Maze &maze)
+{
+    bool allDead = true;
+    for (const Entity &robot : maze.robots)
+    {
+        if (robot.alive)
+        {
+            allDead = false;
+            break;
+        }
+    }
+
+    return allDead || !maze.player.alive;
+}
+
+/**
+ * Finds the first fence/post when going from a cell in a straight line. 
+ * Tiled mazes have no fence index, so the line is walked, jumping over tiles without fences.
+ * 
+ * @param layout The maze's layout
+ * @param line The starting cell's line
+ * @param column The starting cell's column
+ * @param lineDelta The direction on the y-axis, -1, 0 or 1
+ * @param columnDelta The direction on the x-axis, -1, 0 or 1, not both 0
+ * @param limit How far to look, in tiled mazes
+ * 
+ * @returns How many steps it takes to get there, SIZE_MAX if there's no fence that way
+ */
+size_t stepsToFence(const MazeLayout &layout, long line, long column, const int lineDelta, const int columnDelta, const size_t limit)
+{
+    if (!layout.tiles)
+        return stepsToIndexedCell(layout.fenceLines, line, column, lineDelta, columnDelta);
+
+    TileStore &tiles = *layout.tiles;
+    size_t steps = 0;
+
+    while (steps < limit)
+    {
+        steps++;
+        line += lineDelta;
+        column += columnDelta;
+
+        if (line < 0 || column < 0 || size_t(line) >= layout.nLines || size_t(column) >= layout.nCols)
+            return SIZE_MAX;
+
+        if (tiles.offsets[tileNumber(tiles, column, line)] != 0)
+        {
+            if (tileFence(tiles, column, line))
+                return steps;
+            continue;
+        }
+
+        // Skip to the tile's last cell on the way, it has no fences either
+        size_t skip = SIZE_MAX;
+        if (lineDelta != 0)
+            skip = min(skip, lineDelta > 0 ? TILE_SIZE - 1 - line % TILE_SIZE : line % TILE_SIZE);
+        if (columnDelta != 0)
+            skip = min(skip, columnDelta > 0 ? TILE_SIZE - 1 - column % TILE_SIZE : column % TILE_SIZE);
+
+        steps += skip;
+        line += long(skip) * lineDelta;
+        column += long(skip) * columnDelta;
+    }
+
+    return SIZE_MAX;
+}
+
+/**
+ * Gets the index of a direction in WaitTracker::lines.
+ * 
+ * @param lineDelta The direction on the y-axis, -1, 0 or 1
+ * @param columnDelta The direction on the x-axis, -1, 0 or 1
+ * 
+ * @returns The index
+ */
+uint8_t directionIndex(const int lineDelta, const int columnDelta)
+{
+    return (lineDelta + 1) * 3 + columnDelta + 1;
+}
+
+/**
+ * Gets the line through a cell in a direction, used with WaitTracker::lines. 
+ * Unlike lineKey it works with cells outside the maze, where robots start from.
+ * 
+ * @param lineDelta The direction on the y-axis, -1, 0 or 1
+ * @param columnDelta The direction on the x-axis, -1, 0 or 1, not both 0
+ * @param line The cell's line
+ * @param column The cell's column
+ * @param position Set to the cell's position along the line
+ * 
+ * @returns The line
+ */
+long directionLine(const int lineDelta, const int columnDelta, const long line, const long column, long &position)
+{
+    position = lineDelta == 0 ? column : line;
+
+    if (lineDelta == 0)
+        return line;
+    if (columnDelta == 0)
+        return column;
+    return lineDelta == columnDelta ? line - column : line + column;
+}
+
+/**
+ * Finds the alive robot that is in a cell while a turn is played: the robots before the one moving have moved already. 
+ * Robots in a cell walk in the direction of the player from it, so that's the only direction to check.
+ * 
+ * @param tracker The robots, the turn being played is the one after tracker.turn
+ * @param maze The maze
+ * @param line The cell's line
+ * @param column The cell's column
+ * @param moving The robot moving
+ * 
+ * @returns The robot, SIZE_MAX if there's none
+ */
+size_t trackedRobotAt(const WaitTracker &tracker, const Maze &maze, const long line, const long column, const size_t moving)
+{
+    const int lineDelta = sign(long(maze.player.line) - line), columnDelta = sign(long(maze.player.column) - column);
+    const auto &lines = tracker.lines[directionIndex(lineDelta, columnDelta)];
+
+    for (const size_t turn : {tracker.turn + 1, tracker.turn})
+    {
+        long position;
+        auto found = lines.find(directionLine(lineDelta, columnDelta, line - long(turn) * lineDelta, column - long(turn) * columnDelta, position));
+        if (found == lines.end())
+            continue;
+
+        const auto robots = found->second.equal_range(position);
+        for (auto robot = robots.first; robot != robots.second; robot++)
+        {
+            if ((turn != tracker.turn) == (robot->second < moving))
+                return robot->second;
+        }
+    }
+
+    return SIZE_MAX;
+}
+
+/**
+ * Gets where a robot is on a turn.
+ * 
+ * @param tracker The robots
+ * @param robot The robot's index
+ * @param turn The turn
+ * @param line Set to the robot's line
+ * @param column Set to the robot's column
+ */
+void trackedPosition(const WaitTracker &tracker, const size_t robot, const size_t turn, long &line, long &column)
+{
+    line = tracker.starts[robot].first + long(turn) * (tracker.directions[robot] / 3 - 1);
+    column = tracker.starts[robot].second + long(turn) * (tracker.directions[robot] % 3 - 1);
+}
+
+/**
+ * Finds the first dead robot when going from a cell in a straight line.
+ * 
+ * @param tracker The robots
+ * @param line The starting cell's line
+ * @param column The starting cell's column
+ * @param lineDelta The direction on the y-axis, -1, 0 or 1
+ * @param columnDelta The direction on the x-axis, -1, 0 or 1, not both 0
+ * 
+ * @returns How many steps it takes to get there, SIZE_MAX if there's no dead robot that way
+ */
+size_t stepsToDeadRobot(const WaitTracker &tracker, const long line, const long column, const int lineDelta, const int columnDelta)
+{
+    uint32_t position;
+    auto found = tracker.deadLines.find(lineKey(line, column, lineDelta, columnDelta, position));
+    if (found == tracker.deadLines.end())
+        return SIZE_MAX;
+
+    const set<uint32_t> &cells = found->second;
+
+    if ((lineDelta == 0 ? columnDelta : lineDelta) > 0)
+    {
+        auto next = cells.upper_bound(position);
+        return next == cells.end() ? SIZE_MAX : *next - position;
+    }
+
+    auto next = cells.lower_bound(position);
+    return next == cells.begin() ? SIZE_MAX : position - *prev(next);
+}
+
+/**
+ * Adds a dead robot to the obstacles robots run into.
+ * 
+ * @param tracker The robots
+ * @param maze The maze
+ * @param robot The robot's index
+ */
+void addDeadRobot(WaitTracker &tracker, const Maze &maze, const size_t robot)
+{
+    static const int directions[4][2] = {{0, 1}, {1, 0}, {1, 1}, {1, -1}};
+
+    const Entity &entity = maze.robots[robot];
+    if (!tracker.deadCells.emplace(maze.index(entity.column, entity.line), robot).second)
+        return;
+
+    for (const auto &direction : directions)
+    {
+        uint32_t position;
+        tracker.deadLines[lineKey(entity.line, entity.column, direction[0], direction[1], position)].insert(position);
+    }
+}
+
+/**
+ * Starts tracking a robot from a cell: works out when it runs into something or changes direction, 
+ * and whether it runs into the robot ahead of it next turn.
+ * 
+ * @param tracker The robots
+ * @param maze The maze
+ * @param robot The robot's index
+ * @param line The cell's line
+ * @param column The cell's column
+ * @param turn The turn the robot is in the cell on
+ */
+void trackRobot(WaitTracker &tracker, const Maze &maze, const size_t robot, const long line, const long column, const size_t turn)
+{
+    const long lineOffset = line - long(maze.player.line), columnOffset = column - long(maze.player.column);
+    const int lineDelta = -sign(lineOffset), columnDelta = -sign(columnOffset);
+
+    const uint8_t direction = directionIndex(lineDelta, columnDelta);
+    tracker.directions[robot] = direction;
+    tracker.starts[robot] = {line - long(turn) * lineDelta, column - long(turn) * columnDelta};
+
+    long position;
+    multimap<long, size_t> &robots = tracker.lines[direction][directionLine(lineDelta, columnDelta, tracker.starts[robot].first, tracker.starts[robot].second, position)];
+    robots.emplace(position, robot);
+
+    // The robot reaches the player, or a line through them where it turns
+    size_t steps = labs(lineOffset) && labs(columnOffset) ? min(labs(lineOffset), labs(columnOffset)) : max(labs(lineOffset), labs(columnOffset));
+
+    steps = min(steps, stepsToFence(*maze.layout, line, column, lineDelta, columnDelta, steps));
+    steps = min(steps, stepsToDeadRobot(tracker, line, column, lineDelta, columnDelta));
+
+    tracker.nextEvents[robot] = turn + steps;
+    tracker.events.push({turn + steps, robot});
+
+    // A robot right behind another one with a higher index runs into it as soon as they move
+    const int step = lineDelta == 0 ? columnDelta : lineDelta;
+
+    const auto ahead = robots.equal_range(position + step);
+    for (auto other = ahead.first; other != ahead.second; other++)
+    {
+        if (other->second > robot)
+            tracker.forced.insert(robot);
+    }
+
+    const auto behind = robots.equal_range(position - step);
+    for (auto other = behind.first; other != behind.second; other++)
+    {
+        if (other->second < robot)
+            tracker.forced.insert(other->second);
+    }
+}
+
+/**
+ * Stops tracking a robot, because it's dead or is about to move on its own.
+ * 
+ * @param tracker The robots
+ * @param robot The robot's index
+ */
+void untrackRobot(WaitTracker &tracker, const size_t robot)
+{
+    const uint8_t direction = tracker.directions[robot];
+
+    long position;
+    auto &lines = tracker.lines[direction];
+    auto found = lines.find(directionLine(direction / 3 - 1, direction % 3 - 1, tracker.starts[robot].first, tracker.starts[robot].second, position));
+
+    const auto robots = found->second.equal_range(position);
+    found->second.erase(find_if(robots.first, robots.second, [robot](const pair<const long, size_t> &entry)
+                                { return entry.second == robot; }));
+    if (found->second.empty())
+        lines.erase(found);
+}
+
+/**
+ * Makes the robots behind a cell where a robot died run into it when they get there.
+ * 
+ * @param tracker The robots, after the turn
+ * @param maze The maze
+ * @param line The cell's line
+ * @param column The cell's column
+ */
+void blockRobotsBehind(WaitTracker &tracker, const Maze &maze, const long line, const long column)
+{
+    // Only robots in the same direction can walk through the cell without turning first
+    const int lineDelta = sign(long(maze.player.line) - line), columnDelta = sign(long(maze.player.column) - column);
+    const int step = lineDelta == 0 ? columnDelta : lineDelta;
+
+    long position;
+    const auto &lines = tracker.lines[directionIndex(lineDelta, columnDelta)];
+    auto found = lines.find(directionLine(lineDelta, columnDelta, line - long(tracker.turn) * lineDelta, column - long(tracker.turn) * columnDelta, position));
+    if (found == lines.end())
+        return;
+
+    // The nearest one gets there first, the next ones run into it
+    const multimap<long, size_t> &robots = found->second;
+    auto behind = robots.end();
+    if (step > 0)
+    {
+        auto next = robots.lower_bound(position);
+        if (next != robots.begin())
+            behind = prev(next);
+    }
+    else
+        behind = robots.upper_bound(position);
+
+    if (behind == robots.end())
+        return;
+
+    const size_t robot = behind->second, turn = tracker.turn + labs(position - behind->first);
+    if (turn < tracker.nextEvents[robot])
+    {
+        tracker.nextEvents[robot] = turn;
+        tracker.events.push({turn, robot});
+    }
+}
+
+/**
+ * Starts tracking every robot of a maze.
+ * 
+ * @param tracker The robots
+ * @param maze The maze, the robots must walk straight towards the player
+ */
+void startTracking(WaitTracker &tracker, const Maze &maze)
+{
+    const size_t count = maze.robots.size();
+    tracker.directions.assign(count, 0);
+    tracker.starts.assign(count, {0, 0});
+    tracker.nextEvents.assign(count, SIZE_MAX);
+
+    for (const auto &[cell, robot] : maze.robotCells)
+    {
+        if (!maze.robots[robot].alive)
+            addDeadRobot(tracker, maze, robot);
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const Entity &robot = maze.robots[i];
+        if (robot.alive)
+        {
+            trackRobot(tracker, maze, i, robot.line, robot.column, 0);
+            tracker.alive++;
+        }
+    }
+}
+
+/**
+ * Plays the next turn of waiting for the robots that may not just walk straight, 
+ * the others are only moved when the tracking stops. None of them may reach the player.
+ * 
+ * @param tracker The robots
+ * @param maze The maze
+ * @param playing The robots to play, more are added as they run into the ones played
+ * 
+ * @returns How many robots died
+ */
+size_t playTrackedTurn(WaitTracker &tracker, Maze &maze, set<size_t> &playing)
+{
+    const size_t before = tracker.turn, after = before + 1;
+    const size_t aliveBefore = tracker.alive;
+    vector<size_t> deaths;
+
+    // Robots move in order, the ones before the current one have moved already
+    while (!playing.empty())
+    {
+        const size_t robotIndex = *playing.begin();
+        playing.erase(playing.begin());
+
+        Entity &robot = maze.robots[robotIndex];
+        if (!robot.alive)
+            continue;
+
+        long line, column;
+        trackedPosition(tracker, robotIndex, before, line, column);
+        untrackRobot(tracker, robotIndex);
+
+        line += tracker.directions[robotIndex] / 3 - 1;
+        column += tracker.directions[robotIndex] % 3 - 1;
+        robot.line = line;
+        robot.column = column;
+
+        const size_t cell = maze.index(column, line);
+
+        robot.alive = !entityFenceCollision(robot, maze);
+        if (!robot.alive)
+            traceEvent(TraceEventType::robotDeath, uint8_t(DeathCause::fence), robotIndex, cell);
+
+        auto dead = tracker.deadCells.find(cell);
+        const size_t otherIndex = dead != tracker.deadCells.end() ? dead->second : trackedRobotAt(tracker, maze, line, column, robotIndex);
+
+        if (otherIndex != SIZE_MAX)
+        {
+            Entity &other = maze.robots[otherIndex];
+
+            if (robot.alive)
+                traceEvent(TraceEventType::robotDeath, uint8_t(DeathCause::robot), robotIndex, cell, otherIndex + 1);
+            if (other.alive)
+            {
+                traceEvent(TraceEventType::robotDeath, uint8_t(DeathCause::robot), otherIndex, cell, robotIndex + 1);
+
+                untrackRobot(tracker, otherIndex);
+                other.line = line;
+                other.column = column;
+                other.alive = false;
+                tracker.alive--;
+                addDeadRobot(tracker, maze, otherIndex);
+            }
+
+            robot.alive = false;
+        }
+
+        if (robot.alive)
+            trackRobot(tracker, maze, robotIndex, line, column, after);
+        else
+        {
+            tracker.alive--;
+            addDeadRobot(tracker, maze, robotIndex);
+            deaths.push_back(cell);
+        }
+
+        // Robots that move into the cell later this turn run into whatever is there now
+        for (int lineDelta = -1; lineDelta <= 1; lineDelta++)
+        {
+            for (int columnDelta = -1; columnDelta <= 1; columnDelta++)
+            {
+                const long fromLine = line - lineDelta, fromColumn = column - columnDelta;
+                if ((lineDelta == 0 && columnDelta == 0) || fromLine < 0 || fromColumn < 0 || size_t(fromLine) >= maze.nLines || size_t(fromColumn) >= maze.nCols)
+                    continue;
+                if (sign(long(maze.player.line) - fromLine) != lineDelta || sign(long(maze.player.column) - fromColumn) != columnDelta)
+                    continue;
+
+                const size_t comingIndex = trackedRobotAt(tracker, maze, fromLine, fromColumn, robotIndex);
+                if (comingIndex != SIZE_MAX && comingIndex > robotIndex)
+                    playing.insert(comingIndex);
+            }
+        }
+    }
+
+    tracker.turn = after;
+
+    for (const size_t cell : deaths)
+        blockRobotsBehind(tracker, maze, cell / maze.nCols, cell % maze.nCols);
+
+    return aliveBefore - tracker.alive;
+}
+
+/**
+ * Moves the robots that walked straight to where they are now and stops tracking them.
+ * 
+ * @param tracker The robots
+ * @param maze The maze
+ */
+void stopTracking(const WaitTracker &tracker, Maze &maze)
+{
+    for (size_t i = 0; i < maze.robots.size(); i++)
+    {
+        Entity &robot = maze.robots[i];
+        if (!robot.alive)
+            continue;
+
+        long line, column;
+        trackedPosition(tracker, i, tracker.turn, line, column);
+        robot.line = line;
+        robot.column = column;
+    }
+
+    indexRobots(maze);
+    maze.turn += tracker.turn;
+    maze.moves.append(tracker.turn, 's');
+}
+
+/**
+ * Waits for a number of turns, or until something happens. 
+ * When robots walk straight, each one's next event (running into something, changing direction) is worked out 
+ * when it starts walking, and only the robots something happens to are played, instead of every robot every turn.
+ * 
+ * @param maze The maze
+ * @param maxTurns The most turns to wait
+ * @param untilEvent Whether to stop as soon as a robot or the player dies
+ * @param delta If not null, where the changes made while waiting are stored
+ * 
+ * @returns How many turns were waited
+ */
+size_t waitTurns(Maze &maze, const size_t maxTurns, const bool untilEvent, TurnDelta *delta = nullptr)
+{
+    size_t waited = 0;
+    string errorMessage;
+
+    while (waited < maxTurns && !isGameOver(maze))
+    {
+        if (!maze.layout->smartRobots && maxTurns - waited >= MIN_TRACKED_WAIT)
+        {
+            // Every robot may move, they are only moved when the tracking stops
+            for (size_t i = 0; i < maze.robots.size() && delta; i++)
+            {
+                if (maze.robots[i].alive)
+                    delta->robots.push_back({i, maze.robots[i]});
+            }
+
+            WaitTracker tracker;
+            startTracking(tracker, maze);
+
+            bool stop = false;
+            while (!stop)
+            {
+                while (!tracker.events.empty())
+                {
+                    const auto [turn, robot] = tracker.events.top();
+                    if (maze.robots[robot].alive && tracker.nextEvents[robot] == turn)
+                        break;
+                    tracker.events.pop();
+                }
+
+                size_t next = tracker.forced.empty() ? SIZE_MAX : tracker.turn + 1;
+                if (!tracker.events.empty())
+                    next = min(next, tracker.events.top().first);
+
+                // Nothing happens before the wait is over
+                if (next == SIZE_MAX || next > maxTurns - waited)
+                {
+                    tracker.turn = maxTurns - waited;
+                    stop = true;
+                    break;
+                }
+
+                tracker.turn = next - 1;
+
+                set<size_t> playing;
+                playing.swap(tracker.forced);
+                while (!tracker.events.empty() && tracker.events.top().first == next)
+                {
+                    const size_t robot = tracker.events.top().second;
+                    if (maze.robots[robot].alive && tracker.nextEvents[robot] == next)
+                        playing.insert(robot);
+                    tracker.events.pop();
+                }
+
+                // A robot reaches the player, that turn is played as usual
+                bool reachesPlayer = false;
+                for (const size_t robot : playing)
+                {
+                    long line, column;
+                    trackedPosition(tracker, robot, next, line, column);
+                    reachesPlayer = reachesPlayer || (size_t(line) == maze.player.line && size_t(column) == maze.player.column);
+                }
+
+                if (reachesPlayer)
+                    break;
+
+                const size_t deaths = playTrackedTurn(tracker, maze, playing);
+                stop = tracker.alive == 0 || (untilEvent && deaths > 0);
+            }
+
+            stopTracking(tracker, maze);
+            waited += tracker.turn;
+
+            if (stop)
+                break;
+        }
+
+        size_t aliveBefore = count_if(maze.robots.begin(), maze.robots.end(), [](const Entity &robot)
+                                      { return robot.alive; });
+
+        playTurn(maze, 's', errorMessage, delta);
+        waited++;
+
+        size_t aliveAfter = count_if(maze.robots.begin(), maze.robots.end(), [](const Entity &robot)
+                                     { return robot.alive; });
+
+        if (untilEvent && (aliveAfter != aliveBefore || !maze.player.alive))
+            break;
+    }
+
+    return waited;
+}
+
+/**
+ * Re-plays a move a number of times, see replayMove. Waiting is played through at once, see waitTurns.
+ * 
+ * @param maze The maze
+ * @param move The move
+ * @param count How many times to play it
+ * @param errorMessage The error message returned if the move is invalid
+ * 
+ * @returns false if the move is invalid or the game ends before it's played that many times
+ */
+bool replayMoves(Maze &maze, const char move, const size_t count, string &errorMessage)
+{
+    if (move == 's')
+        return !isGameOver(maze) && waitTurns(maze, count, false) == count;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        // Moves after the game ended
+        if (isGameOver(maze) || !replayMove(maze, move, errorMessage))
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * Asks the user for movement and plays the turn if it's valid.
+ * If it's invalid shows a helpful error message.
+ * 
+ * @param maze The maze
+ * @param delta Where the changes made during the turn are stored
+ * @param validInput Whether the input was valid
+ * @param errorMessage The error message returned if the input is invalid
+ * 
+ * @returns false if the user wants to exit the game
+ */
+bool movePlayer(Maze &maze, TurnDelta &delta, bool &validInput, string &errorMessage)
+{
+    string input;
+
+    cout << "Insert movement: ";
+
+    if (!getInput(input))
+        return false;
+
+    // Undo, "u" or "u <number of moves>"
+    if (!input.empty() && tolower(static_cast<unsigned char>(input.at(0))) == 'u')
+    {
+        size_t count = 1;
+
+        if (input.length() > 1)
+        {
+            string number = input.substr(1);
+            normalizeInput(number);
+
+            if (number.empty() || number.length() > 9 || !allDigits(number))
+            {
+                validInput = false;
+                errorMessage = GENERIC_ERROR;
+                return true;
+            }
+
+            count = stoul(number);
+        }
+
+        validInput = rewind(maze, count, errorMessage);
+        return true;
+    }
+
+    // Wait, "s <number of turns>" or "s !" to wait until something happens
+    if (input.length() > 1 && tolower(static_cast<unsigned char>(input.at(0))) == 's')
+    {
+        string number = input.substr(1);
+        normalizeInput(number);
+
+        if (number == "!")
+        {
+            // Robots always reach the player or die before this
+            validInput = true;
+            waitTurns(maze, maze.nLines * maze.nCols + 1, true, &delta);
+            return true;
+        }
+
+        if (number.empty() || number.length() > 9 || !allDigits(number) || stoul(number) == 0)
+        {
+            validInput = false;
+            errorMessage = GENERIC_ERROR;
+            return true;
+        }
+
+        validInput = true;
+        waitTurns(maze, stoul(number), false, &delta);
+        return true;
+    }
+
+    if (input.length() != 1)
+    {
+        validInput = false;
+        errorMessage = GENERIC_ERROR;
+        return true;
+    }
+
+    validInput = playTurn(maze, tolower(static_cast<unsigned char>(input.at(0))), errorMessage, &delta);
+    return true;
+}
+
+/**
+ * Updates the maze's visualMap with the fences, the robots and the player. 
+ * Mazes bigger than VIEW_LINES by VIEW_COLUMNS only have the part around the player in it.
+ * 
+ * @param maze The maze
+ */
+void updateVisualMap(Maze &maze)
+{
+    maze.viewLines = min(maze.nLines, VIEW_LINES);
+    maze.viewCols = min(maze.nCols, VIEW_COLUMNS);
+    maze.viewLine = min(maze.player.line - min(maze.player.line, maze.viewLines / 2), maze.nLines - maze.viewLines);
+    maze.viewColumn = min(maze.player.column - min(maze.player.column, maze.viewCols / 2), maze.nCols - maze.viewCols);
+
+    maze.visualMap.resize(maze.viewLines * maze.viewCols);
+    for (size_t l = 0; l < maze.viewLines; l++)
+    {
+        for (size_t c = 0; c < maze.viewCols; c++)
+            maze.visualMap[l * maze.viewCols + c] = isFence(maze, maze.viewColumn + c, maze.viewLine + l) ? '*' : ' ';
+    }
+
+    auto show = [&](const Entity &entity, const char cell)
+    {
+        if (entity.line >= maze.viewLine && entity.line < maze.viewLine + maze.viewLines &&
+            entity.column >= maze.viewColumn && entity.column < maze.viewColumn + maze.viewCols)
+            maze.visualMap[(entity.line - maze.viewLine) * maze.viewCols + entity.column - maze.viewColumn] = cell;
+    };
+
+    for (const Entity &r : maze.robots)
+    {
+        show(r, r.alive ? 'R' : 'r');
+    }
+
+    show(maze.player, maze.player.alive ? 'H' : 'h');
+}
+
+/**
+ * Checks if the terminal understands ANSI escape codes and is big enough to show a maze in place.
+ * 
+ * @param maze The maze, with its visualMap up to date
+ * @returns false if the maze should be printed as plain text
+ */
+bool canRenderInPlace(const Maze &maze)
+{
+#ifdef _WIN32
+    return false;
+#else
+    const char *term = getenv("TERM");
+    if (!isatty(STDOUT_FILENO) || term == nullptr || term == "dumb"s || term == ""s)
+        return false;
+
+    // The maze, an empty line and the prompt must fit, otherwise the terminal scrolls
+    winsize size;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_row > 0)
+        return maze.viewLines + 3 <= size.ws_row && maze.viewCols <= size.ws_col;
+
+    return true;
+#endif
+}
+
+/**
+ * Gets the ANSI escape code used to color a cell of the maze.
+ * 
+ * @param cell The cell, as found in the visualMap
+ * @returns The escape code
+ */
+const char *cellColor(const char cell)
+{
+    switch (cell)
+    {
+    case '*':
+        return "\x1b[0;33m";
+    case 'R':
+        return "\x1b[0;1;31m";
+    case 'r':
+        return "\x1b[0;2;31m";
+    case 'H':
+        return "\x1b[0;1;32m";
+    case 'h':
+        return "\x1b[0;2;32m";
+    default:
+        return "\x1b[0m";
+    }
+}
+
+/**
+ * Writes a buffer to stdout with as few system calls as possible, usually one.
+ * 
+ * @param buffer What to write
+ */
+void writeFrame(const string &buffer)
+{
+    // Anything still in cout must come before the frame
+    cout.flush();
+
+#ifdef _WIN32
+    cout.write(buffer.data(), buffer.size());
+    cout.flush();
+#else
+    size_t written = 0;
+    while (written < buffer.size())
+    {
+        ssize_t result = write(STDOUT_FILENO, buffer.data() + written, buffer.size() - written);
+        if (result < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        written += result;
+    }
+#endif
+}
+
+/**
+ * Prints the maze's visualMap. 
+ * If the terminal supports it, only the cells that changed since the last frame are redrawn, in color,
+ * otherwise the whole maze is printed as plain text. Either way the frame is written all at once.
+ * 
+ * @param maze The maze
+ * @param renderer What was displayed before
+ */
+void displayMaze(const Maze &maze, Renderer &renderer)
+{
+    string &buffer = renderer.buffer;
+    buffer.clear();
+
+    if (!canRenderInPlace(maze))
+    {
+        for (size_t i = 0; i < maze.visualMap.size(); i++)
+        {
+            if (i % maze.viewCols == 0)
+                buffer += '\n';
+
+            buffer += maze.visualMap[i];
+        }
+        buffer += '\n';
+
+        renderer.lastFrame.clear();
+        writeFrame(buffer);
+        return;
+    }
+
+    // Redraw everything if the last frame may not be on screen anymore
+    if (renderer.redraw || renderer.lastFrame.size() != maze.visualMap.size())
+    {
+        renderer.lastFrame.assign(maze.visualMap.size(), 0);
+        buffer += "\x1b[H\x1b[2J";
+        renderer.redraw = false;
+    }
+
+    const char *color = nullptr;
+    // Where the terminal's cursor is, as a map index
+    size_t cursor = SIZE_MAX;
+
+    for (size_t i = 0; i < maze.visualMap.size(); i++)
+    {
+        const char cell = maze.visualMap[i];
+        if (cell == renderer.lastFrame[i])
+            continue;
+
+        // Only move the cursor if it isn't already there
+        if (cursor != i || i % maze.viewCols == 0)
+            buffer += "\x1b["s + to_string(i / maze.viewCols + 1) + ';' + to_string(i % maze.viewCols + 1) + 'H';
+
+        const char *newColor = cellColor(cell);
+        if (newColor != color)
+        {
+            buffer += newColor;
+            color = newColor;
+        }
+
+        buffer += cell;
+        cursor = i + 1;
+        renderer.lastFrame[i] = cell;
+    }
+
+    // Leave the cursor under the maze and clear old prompts and messages
+    buffer += "\x1b[0m\x1b["s + to_string(maze.viewLines + 2) + ";1H\x1b[J";
+
+    writeFrame(buffer);
+}
+
+/**
+ * This struct holds timing counters of a real time game, used to tune the engine.
+ */
+struct TickStats
+{
+    /** How many times the robots moved */
+    size_t ticks = 0;
+    /** How many ticks ran more than a whole interval late */
+    size_t overruns = 0;
+    /** How many ticks were skipped because the game fell too far behind */
+    size_t dropped = 0;
+    /** How late ticks ran, added up */
+    chrono::microseconds totalLateness = chrono::microseconds(0);
+    /** The latest a tick ran */
+    chrono::microseconds maxLateness = chrono::microseconds(0);
+    /** How many frames were drawn */
+    size_t frames = 0;
+    /** The longest it took to draw a frame */
+    chrono::microseconds maxFrameTime = chrono::microseconds(0);
+};
+
+#ifndef _WIN32
+/**
+ * Makes the terminal send each key as soon as it's pressed, without echoing it.
+ * 
+ * @param saved Where the previous settings are stored, to be restored later
+ * 
+ * @returns false if stdin is not a terminal
+ */
+bool enableRawInput(termios &saved)
+{
+    if (tcgetattr(STDIN_FILENO, &saved) != 0)
+        return false;
+
+    termios raw = saved;
+    raw.c_lflag &= ~(ICANON | ECHO | ISIG);
+    raw.c_cc[VMIN] = 0;
+    raw.c_cc[VTIME] = 0;
+
+    return tcsetattr(STDIN_FILENO, TCSANOW, &raw) == 0;
+}
+
+/**
+ * Restores the terminal settings changed by enableRawInput.
+ * 
+ * @param saved The previous settings
+ */
+void restoreInput(const termios &saved)
+{
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &saved);
+}
+
+/**
+ * Gets the move of an arrow key, from the final byte of its escape sequence ("ESC [ A" or "ESC O A" for up).
+ * 
+ * @param key The final byte
+ * @returns The move, or 0 if the sequence isn't an arrow key
+ */
+char arrowKeyMove(const char key)
+{
+    switch (key)
+    {
+    case 'A':
+        return 'w';
+    case 'B':
+        return 'x';
+    case 'C':
+        return 'd';
+    case 'D':
+        return 'a';
+    default:
+        return 0;
+    }
+}
+#endif
+
+/**
+ * Prints the timing counters of a real time game.
+ * 
+ * @param out Where to print
+ * @param stats The counters
+ */
+void printTickStats(ostream &out, const TickStats &stats)
+{
+    out << "Ticks: " << stats.ticks << ", late by a whole tick: " << stats.overruns << ", dropped: " << stats.dropped
+        << ", average lateness: " << (stats.ticks ? stats.totalLateness.count() / stats.ticks : 0) << "us"
+        << ", max lateness: " << stats.maxLateness.count() << "us"
+        << ", frames: " << stats.frames << ", slowest frame: " << stats.maxFrameTime.count() << "us\n";
+}
+
+/**
+ * Plays a game in real time: the robots move every tick while the player moves whenever a key is pressed. 
+ * Runs until the game is over or the user leaves.
+ * 
+ * @param gameState The state the game is in
+ * @param maze The maze
+ * @param renderer What was displayed before
+ * 
+ * @returns false if the user wants to exit the game
+ */
+bool realTimeGame(GameState &gameState, Maze &maze, Renderer &renderer)
+{
+#ifdef _WIN32
+    maze.realTime = false;
+    return true;
+#else
+    using clock = chrono::steady_clock;
+
+    termios saved;
+    if (!enableRawInput(saved))
+    {
+        // Play turn by turn instead
+        maze.realTime = false;
+        return true;
+    }
+
+    TickStats stats;
+    string errorMessage;
+    bool running = true;
+    bool changed = true;
+
+    // How far into an escape sequence the keys are, they can be split between reads
+    enum class Escape
+    {
+        none,
+        started,
+        sequence
+    } escape = Escape::none;
+    clock::time_point nextTick = clock::now() + maze.layout->tickInterval;
+
+    while (!isGameOver(maze))
+    {
+        if (changed)
+        {
+            auto frameStart = clock::now();
+
+            updateVisualMap(maze);
+            displayMaze(maze, renderer);
+            cout << "Move with Q W E A S D Z X C, leave with Ctrl-D" << flush;
+
+            auto frameTime = chrono::duration_cast<chrono::microseconds>(clock::now() - frameStart);
+            stats.frames++;
+            stats.maxFrameTime = max(stats.maxFrameTime, frameTime);
+            changed = false;
+        }
+
+        // Wait for a key until the next tick
+        auto timeout = chrono::duration_cast<chrono::milliseconds>(nextTick - clock::now()).count();
+        pollfd input = {STDIN_FILENO, POLLIN, 0};
+
+        if (poll(&input, 1, max<long>(timeout, 0)) > 0)
+        {
+            char keys[64];
+            ssize_t count = read(STDIN_FILENO, keys, sizeof(keys));
+
+            // Ctrl-C, Ctrl-D, Ctrl-Z or the end of the input
+            if (count == 0 || (count > 0 && any_of(keys, keys + count, [](char c)
+                                                    { return c == 3 || c == 4 || c == 26; })))
+            {
+                running = false;
+                break;
+            }
+
+            for (ssize_t i = 0; i < count && !isGameOver(maze); i++)
+            {
+                char move = tolower(static_cast<unsigned char>(keys[i]));
+
+                // Arrow keys move, other escape sequences are skipped up to their final byte
+                if (escape == Escape::started && (keys[i] == '[' || keys[i] == 'O'))
+                {
+                    escape = Escape::sequence;
+                    continue;
+                }
+
+                if (escape == Escape::sequence)
+                {
+                    // Parameter and intermediate bytes
+                    if (keys[i] >= 0x20 && keys[i] <= 0x3f)
+                        continue;
+
+                    escape = Escape::none;
+                    move = arrowKeyMove(keys[i]);
+                }
+                else
+                    escape = keys[i] == '\x1b' ? Escape::started : Escape::none;
+
+                int columnDelta, lineDelta;
+
+                // Ignore anything that isn't a move, as well as moves into walls and dead robots
+                if (moveDelta(move, columnDelta, lineDelta) && stepPlayer(maze, move, errorMessage))
+                {
+                    maze.moves += toupper(static_cast<unsigned char>(move));
+                    changed = true;
+                }
+            }
+        }
+
+        // Run every tick that is due, but don't try to catch up forever
+        clock::time_point now = clock::now();
+        size_t caughtUp = 0;
+        size_t turn = maze.turn;
+
+        while (now >= nextTick && !isGameOver(maze))
+        {
+            if (caughtUp == MAX_CATCHUP_TICKS)
+            {
+                while (now >= nextTick)
+                {
+                    nextTick += maze.layout->tickInterval;
+                    stats.dropped++;
+                }
+                break;
+            }
+
+            auto lateness = chrono::duration_cast<chrono::microseconds>(now - nextTick);
+            stats.totalLateness += lateness;
+            stats.maxLateness = max(stats.maxLateness, lateness);
+            stats.overruns += lateness >= maze.layout->tickInterval;
+            stats.ticks++;
+
+            tickRobots(maze);
+            nextTick += maze.layout->tickInterval;
+            caughtUp++;
+            changed = true;
+        }
+
+        if (maze.turn / AUTOSAVE_INTERVAL != turn / AUTOSAVE_INTERVAL && !isGameOver(maze))
+            saveGame(maze);
+    }
+
+    restoreInput(saved);
+
+    if (!running)
+    {
+        // Keep the game so it can be resumed later
+        cout << '\n';
+        saveGame(maze);
+        return false;
+    }
+
+    updateVisualMap(maze);
+    displayMaze(maze, renderer);
+    printTickStats(cout, stats);
+
+    renderer.lastFrame.clear();
+    renderer.redraw = true;
+    recordGame(maze);
+    deleteSave(maze.mazeNumber);
+    gameState = GameState::finished;
+    return true;
+#endif
+}
+
+/**
+ * Handles in game logic:
+ * - Shows the maze
+ * - Asks the player for input and moves him
+ * - Moves the robots
+ * - Handles collisions
+ * 
+ * @param gameState The state the game is in
+ * @param maze The maze
+ * @param renderer What was displayed before
+ * @param validInput Whether the last input was valid
+ * @param errorMessage The error message returned if the input was invalid
+ * 
+ * @returns false if the user wants to exit the game
+ */
+bool inGame(GameState &gameState, Maze &maze, Renderer &renderer, bool &validInput, string &errorMessage)
+{
+    if (maze.realTime)
+        return realTimeGame(gameState, maze, renderer);
+
+    // Show maze
+    if (validInput)
+    {
+        updateVisualMap(maze);
+        displayMaze(maze, renderer);
+    }
+    else
+    {
+        // The error message may have scrolled the maze
+        renderer.redraw = true;
+    }
+
+    // Check if game is over
+    if (isGameOver(maze))
+    {
+        renderer.lastFrame.clear();
+        renderer.redraw = true;
+        recordGame(maze);
+        deleteSave(maze.mazeNumber);
+        gameState = GameState::finished;
+        return true;
+    }
+
+    recordKeyframe(maze);
+
+    TurnDelta delta;
+    delta.playerBefore = maze.player;
+    size_t turn = maze.turn;
+
+    if (!movePlayer(maze, delta, validInput, errorMessage))
+    {
+        // Keep the game so it can be resumed later
+        saveGame(maze);
+        return false;
+    }
+
+    // Only record turns that were played, not invalid moves or undos
+    if (!validInput || maze.turn <= turn)
+        return true;
+
+    delta.turns = maze.turn - turn;
+    recordTurn(maze, delta);
+
+    if (maze.turn / AUTOSAVE_INTERVAL != turn / AUTOSAVE_INTERVAL)
+        saveGame(maze);
+
+    return true;
+}
+
+/**
+ * Computes the seal of a leaderboard entry: a hash of its name, points and proof, 
+ * so the moves can't be moved to another name or time without it showing.
+ * 
+ * @param entry The entry
+ * @returns The seal
+ */
+uint64_t proofSeal(const LeaderboardEntry &entry)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+
+    for (char c : entry.name)
+        hashByte(hash, static_cast<unsigned char>(c));
+    for (int i = 0; i < 64; i += 8)
+    {
+        hashByte(hash, (uint64_t(entry.points) >> i) & 0xff);
+        hashByte(hash, (entry.mazeHash >> i) & 0xff);
+    }
+    for (char c : entry.moves)
+        hashByte(hash, static_cast<unsigned char>(c));
+
+    return hash;
+}
+
+/**
+ * Reads a leaderboard file.
+ * 
+ * @param mazeNumber Which maze to read (in the range "01" to "99")
+ * @param leaderboard Variable where the leaderboard is stored
+ */
+void readLeaderboard(const string &mazeNumber, Leaderboard &leaderboard)
+{
+    ifstream file("MAZE_"s + mazeNumber + "_WINNERS.txt"s);
+
+    // File doesn't exist
+    if (!file.is_open())
+        return;
+
+    // Ignore header
+    file.ignore(100, '\n');
+    file.ignore(100, '\n');
+
+    string line;
+    while (getline(file, line))
+    {
+        stringstream linestream(line);
+        LeaderboardEntry person;
+        size_t nameLength = 0;
+        char c;
+
+        while (nameLength < 15)
+        {
+            c = linestream.get();
+            nameLength += isUtf8Byte1(c);
+            person.name += c;
+        }
+
+        // Ignore dash
+        linestream >> c >> person.points;
+
+        // Proof of the win, if there is one
+        if (linestream >> c >> hex >> person.mazeHash >> person.moves)
+        {
+            if (c != '-')
+                person.moves.clear();
+
+            linestream >> person.seal;
+        }
+
+        leaderboard.push_back(person);
+    }
+
+    file.close();
+}
+
+/**
+ * Function used with std::sort to sort a leaderboard by points.
+ * 
+ * @param person1 The first person
+ * @param person2 The second person
+ * 
+ * @returns true if the second person's points are greater than the first's
+ */
+bool compareLeaderboardPoints(LeaderboardEntry person1, LeaderboardEntry person2)
+{
+    return (person1.points < person2.points);
+}
+
+/**
+ * Sorts a leaderboard by points.
+ * 
+ * @param leaderboard The leaderboard
+ */
+void sortLeaderboard(Leaderboard &leaderboard)
+{
+    sort(leaderboard.begin(), leaderboard.end(), compareLeaderboardPoints);
+}
+
+/**
+ * Prints a formated leaderboard onto an output stream.
+ * 
+ * @param out Where to print the leaderboard
+ * @param leaderboard The leaderboard
+ * @param proofs Whether to print each entry's maze hash, moves and seal after its time
+ */
+void printLeaderboard(ostream &out, Leaderboard &leaderboard, bool proofs = false)
+{
+    out << "Player          - Time\n----------------------\n";
+
+    for (auto person : leaderboard)
+    {
+        out << person.name << " - " << setw(4) << right << person.points;
+
+        if (proofs && !person.moves.empty())
+            out << " - " << setw(16) << setfill('0') << hex << person.mazeHash << ' ' << person.moves
+                << ' ' << setw(16) << person.seal << dec << setfill(' ');
+
+        out << '\n';
+    }
+}
+
+/**
+ * Saves a formated leaderboard onto a file.
+ * 
+ * @param mazeNumber Which maze file to save to (in the range "01" to "99")
+ * @param leaderboard The leaderboard
+ */
+void saveLeaderboard(const string &mazeNumber, Leaderboard &leaderboard)
+{
+    string fileName = "MAZE_"s + mazeNumber + "_WINNERS.txt"s;
+
+    ofstream file;
+    file.open(fileName);
+
+    printLeaderboard(file, leaderboard, true);
+
+    traceEvent(TraceEventType::leaderboardWrite, 0, mazeNumberValue(mazeNumber), leaderboard.size());
+}
+
+/**
+ * Searches the leaderboard for an entry with the same name. 
+ * If it's found, asks the user if they want to use it or change it.
+ * 
+ * @param leaderboard The leaderboard
+ * @param person The person with the name to search for
+ * @param validInput Whether the last input was valid. Is set to false if an entry with the name is found
+ * @param errorMessage The error message returned if the input was invalid
+ * 
+ * @returns false if the user wants to exit the game
+ */
+bool searchSameName(Leaderboard &leaderboard, const LeaderboardEntry &person, bool &validInput, string &errorMessage)
+{
+    for (auto &other : leaderboard)
+    {
+        if (other.name == person.name)
+        {
+            cout << "That name already exits in the leaderboard! Do you wish to continue with it? (y/N) ";
+
+            string decision;
+
+            if (!getInput(decision))
+                return false;
+
+            if (decision == "y" || decision == "Y")
+            {
+                // Only save new score if it's better than the current one
+                if (person.points < other.points)
+                    other = person;
+            }
+            else
+            {
+                validInput = false;
+                errorMessage = ANOTHER_NAME;
+            }
+            return true;
+        }
+    }
+
+    leaderboard.push_back(person);
+    return true;
+}
+
+/**
+ * Shows the game result.
+ * If the player won asks for his name and saves it on the leaderboard.
+ * 
+ * @param gameState The state the game is in
+ * @param maze The maze
+ * @param validInput Whether the last input was valid
+ * @param errorMessage The error message returned if the input was invalid
+ * 
+ * @returns false if the user wants to exit the game
+ */
+bool finished(GameState &gameState, const Maze &maze, bool &validInput, string &errorMessage)
+{
+    if (maze.player.alive)
+    {
+        if (validInput)
+            cout << "You win!\n";
+
+        cout << "Please insert your name: ";
+
+        LeaderboardEntry person;
+        Leaderboard leaderboard;
+
+        // Save points as soon as possible
+        person.points = chrono::duration_cast<chrono::seconds>(elapsedTime(maze)).count();
+        person.mazeHash = maze.layout->hash;
+        person.moves = encodeMoves(maze.moves);
+
+        if (!getInput(person.name))
+            return false;
+
+        // Check name length
+        size_t nameLength = utf8Length(person.name);
+        if (nameLength > 15)
+        {
+            validInput = false;
+            errorMessage = INVALID_NAME;
+            return true;
+        }
+        else if (nameLength == 0)
+        {
+            validInput = false;
+            errorMessage = GENERIC_ERROR;
+            return true;
+        }
+        validInput = true;
+        // Name is valid, pad it out to a length of 15
+        person.name += string(15 - nameLength, ' ');
+        person.seal = proofSeal(person);
+
+        readLeaderboard(maze.mazeNumber, leaderboard);
+
+        if (!searchSameName(leaderboard, person, validInput, errorMessage))
+            return false;
+
+        if (!validInput)
+            return true;
+
+        sortLeaderboard(leaderboard);
+
+        cout << '\n';
+        printLeaderboard(cout, leaderboard);
+        cout << '\n';
+
+        saveLeaderboard(maze.mazeNumber, leaderboard);
+    }
+    else
+        cout << "You lose :(\n";
+
+    cout << "Press enter to continue\n";
+    gameState = GameState::mainMenu;
+
+    string i;
+    return getInput(i);
+}
+
+/**
+ * This struct represents a single problem found while validating a maze file.
+ */
+struct MazeIssue
+{
+    /** Line in the file where the problem was found, starting at 1 (0 if it concerns the whole file) */
+    size_t line;
+    /** Column in the file where the problem was found, starting at 1 (0 if it concerns the whole line) */
+    size_t column;
+    /** What is wrong */
+    string message;
+};
+
+/**
+ * This struct holds the result of validating a maze file.
+ */
+struct MazeReport
+{
+    /** Path of the validated file */
+    string path;
+    /** Every problem found in the file */
+    vector<MazeIssue> issues;
+    /** Size of the maze on the y-axis, as stated in the header */
+    size_t nLines = 0;
+    /** Size of the maze on the x-axis, as stated in the header */
+    size_t nCols = 0;
+    /** Number of robots in the maze */
+    size_t robots = 0;
+    /** Number of fences/posts in the maze */
+    size_t fences = 0;
+    /** Number of players in the maze */
+    size_t players = 0;
+    /** Number of cells read from the file */
+    size_t cells = 0;
+};
+
+/**
+ * Validates the contents of a maze file. 
+ * Unlike loadMaze, doesn't stop at the first problem, every one of them is added to the report.
+ * 
+ * @param contents The whole file
+ * @param report Where the problems and statistics are stored
+ */
+void validateMaze(const string &contents, MazeReport &report)
+{
+    size_t lineEnd = contents.find('\n');
+    string header = contents.substr(0, lineEnd);
+    stringstream headerStream(header);
+    char x = 0;
+
+    headerStream >> report.nLines >> x >> report.nCols;
+
+    bool validHeader = x == 'x' && !headerStream.fail();
+
+    string options;
+    chrono::milliseconds tickInterval;
+    bool smartRobots;
+    if (validHeader)
+    {
+        getline(headerStream, options);
+        validHeader = parseMazeOptions(options, tickInterval, smartRobots);
+    }
+
+    if (!validHeader)
+    {
+        // Nothing else can be checked without a size
+        report.nLines = report.nCols = 0;
+        report.issues.push_back({1, 0, INVALID_MAZE_HEADER_SIZE});
+        return;
+    }
+
+    size_t fileLine = 1;
+    size_t mazeLines = 0;
+    size_t start = lineEnd == string::npos ? contents.length() : lineEnd + 1;
+
+    while (start < contents.length())
+    {
+        lineEnd = contents.find('\n', start);
+        if (lineEnd == string::npos)
+            lineEnd = contents.length();
+
+        fileLine++;
+
+        // loadMaze ignores empty lines
+        if (lineEnd == start)
+        {
+            start = lineEnd + 1;
+            continue;
+        }
+
+        for (size_t i = start; i < lineEnd; i++)
+        {
+            switch (contents[i])
+            {
+            case 'R':
+                report.robots++;
+                break;
+            case 'H':
+                report.players++;
+                if (report.players > 1)
+                    report.issues.push_back({fileLine, i - start + 1, MULTIPLE_PLAYERS});
+                break;
+            case '*':
+                report.fences++;
+                break;
+            case ' ':
+                break;
+            default:
+                report.issues.push_back({fileLine, i - start + 1, INVALID_MAZE_CHARACTER});
+            }
+        }
+
+        if (lineEnd - start != report.nCols)
+            report.issues.push_back({fileLine, 0, INVALID_MAZE_LINE});
+
+        report.cells += lineEnd - start;
+        mazeLines++;
+        start = lineEnd + 1;
+    }
+
+    if (report.players == 0)
+        report.issues.push_back({0, 0, NO_PLAYER});
+
+    if (mazeLines != report.nLines || report.cells != report.nLines * report.nCols)
+        report.issues.push_back({0, 0, INVALID_MAZE_SIZE});
+}
+
+/**
+ * Reads a maze file and validates it.
+ * 
+ * @param path The file to validate
+ * @param report Where the problems and statistics are stored
+ */
+void validateMazeFile(const string &path, MazeReport &report)
+{
+    report.path = path;
+
+    ifstream file(path, ios::binary);
+
+    // File doesn't exist
+    if (!file.is_open())
+    {
+        report.issues.push_back({0, 0, MAZE_NOT_FOUND});
+        return;
+    }
+
+    // Read everything at once, it's much faster than going through the stream character by character
+    string contents;
+    file.seekg(0, ios::end);
+    contents.resize(file.tellg());
+    file.seekg(0, ios::beg);
+    file.read(&contents[0], contents.size());
+
+    validateMaze(contents, report);
+}
+
+/**
+ * Checks if a file name looks like a maze, "MAZE_<something>.txt", but not a leaderboard.
+ * 
+ * @param fileName The name of the file, without the directory
+ * @returns true if the file should be validated
+ */
+bool isMazeFileName(const string &fileName)
+{
+    const string prefix = "MAZE_"s, suffix = ".txt"s, winners = "_WINNERS.txt"s;
+
+    auto endsWith = [&](const string &end)
+    {
+        return fileName.length() >= end.length() && fileName.compare(fileName.length() - end.length(), end.length(), end) == 0;
+    };
+
+    return fileName.compare(0, prefix.length(), prefix) == 0 && endsWith(suffix) && !endsWith(winners);
+}
+
+/**
+ * Runs a task for every index from 0 to count - 1 on a pool of threads. 
+ * Indices are handed out one at a time, so slow tasks don't hold back the other threads.
+ * 
+ * @param count How many times to run the task
+ * @param threads How many threads to use, 0 to use one per core
+ * @param task The task, receives the index
+ */
+void parallelFor(size_t count, unsigned threads, const function<void(size_t)> &task)
+{
+    if (threads == 0)
+        threads = max(thread::hardware_concurrency(), 1u);
+    threads = min<size_t>(threads, max<size_t>(count, 1));
+
+    atomic<size_t> next(0);
+    auto worker = [&]()
+    {
+        for (size_t i = next++; i < count; i = next++)
+            task(i);
+    };
+
+    vector<thread> pool;
+    for (unsigned i = 1; i < threads; i++)
+        pool.emplace_back(worker);
+
+    // This thread also works
+    worker();
+
+    for (thread &t : pool)
+        t.join();
+}
+
+/**
+ * Escapes a string so it can be written inside quotes in a JSON file.
+ * 
+ * @param str The string to escape
+ * @returns The escaped string
+ */
+string jsonEscape(const string &str)
+{
+    string escaped;
+
+    for (char c : str)
+    {
+        if (c == '"' || c == '\\')
+            escaped += '\\';
+
+        if (static_cast<unsigned char>(c) < ' ')
+        {
+            stringstream code;
+            code << "\\u" << setw(4) << setfill('0') << hex << int(c);
+            escaped += code.str();
+        }
+        else
+            escaped += c;
+    }
+
+    return escaped;
+}
+
+/**
+ * Writes the validation reports as JSON.
+ * 
+ * @param out Where to write
+ * @param reports The reports
+ */
+void printValidationSummary(ostream &out, const vector<MazeReport> &reports)
+{
+    size_t valid = 0;
+    for (const MazeReport &report : reports)
+        valid += report.issues.empty();
+
+    out << "{\"files\":" << reports.size() << ",\"valid\":" << valid << ",\"invalid\":" << reports.size() - valid << ",\"results\":[";
+
+    for (size_t i = 0; i < reports.size(); i++)
+    {
+        const MazeReport &report = reports.at(i);
+        size_t size = report.nLines * report.nCols;
+
+        out << (i ? "," : "") << "\n{\"file\":\"" << jsonEscape(report.path) << "\""
+            << ",\"valid\":" << (report.issues.empty() ? "true" : "false")
+            << ",\"lines\":" << report.nLines << ",\"columns\":" << report.nCols
+            << ",\"robots\":" << report.robots << ",\"fences\":" << report.fences
+            << ",\"fenceDensity\":" << (size ? double(report.fences) / size : 0.0)
+            << ",\"errors\":[";
+
+        for (size_t j = 0; j < report.issues.size(); j++)
+        {
+            const MazeIssue &issue = report.issues.at(j);
+            out << (j ? "," : "") << "{\"line\":" << issue.line << ",\"column\":" << issue.column
+                << ",\"message\":\"" << jsonEscape(issue.message) << "\"}";
+        }
+
+        out << "]}";
+    }
+
+    out << "\n]}\n";
+}
+
+/**
+ * Reads the number given to a command line option, such as "--threads 4".
+ * 
+ * @param args The command line arguments
+ * @param i The option's position, moved to the number
+ * @param value Where the number is stored
+ * 
+ * @returns false, after saying why, if it's not a number
+ */
+bool readCountOption(const vector<string> &args, size_t &i, size_t &value)
+{
+    const string &option = args.at(i), &number = args.at(++i);
+
+    if (number.empty() || number.length() > 9 || !allDigits(number))
+    {
+        cerr << option << " needs a number, not \"" << number << "\"\n";
+        return false;
+    }
+
+    value = stoul(number);
+    return true;
+}
+
+/**
+ * Pads a maze number given on the command line to two digits, like the maze menu does.
+ * "5" -> "05"
+ * 
+ * @param number The maze number
+ * @returns The padded maze number
+ */
+string padMazeNumber(const string &number)
+{
+    return string(2 - min<size_t>(number.length(), 2), '0') + number;
+}
+
+/**
+ * Loads the mazes a tool works on. Mazes that can't be loaded are skipped with a message on the error output.
+ * 
+ * @param mazeNumbers The maze numbers given on the command line, padded with padMazeNumber
+ * @param listed Whether a maze in this directory is worked on when no numbers are given, by maze number
+ * 
+ * @returns The mazes
+ */
+vector<Maze> loadToolMazes(vector<string> mazeNumbers, const function<bool(const string &)> &listed)
+{
+    // Every maze in this directory by default
+    if (mazeNumbers.empty())
     {
-        maze.mazeNumber = "0"s + maze.mazeNumber;
+        for (int i = 1; i < 100; i++)
+        {
+            string number = string(i < 10 ? "0" : "") + to_string(i);
+            if (listed(number))
+                mazeNumbers.push_back(number);
+        }
     }
 
-    // User wants to return to main menu
-    if (maze.mazeNumber == "00")
+    vector<Maze> mazes;
+    for (const string &number : mazeNumbers)
     {
-        cout << "\n";
-        gameState = GameState::mainMenu;
-        return true;
+        Maze maze;
+        maze.mazeNumber = number;
+        bool validInput = true;
+        string errorMessage;
+
+        if (!validMazeNumber(number) || !loadMaze(maze, validInput, errorMessage))
+        {
+            cerr << "Skipping maze " << number << ": " << (validMazeNumber(number) ? errorMessage : INVALID_MAZE_NUMBER) << '\n';
+            continue;
+        }
+
+        mazes.push_back(move(maze));
     }
 
-    // Maze number is invalid
-    if (!validMazeNumber(maze.mazeNumber))
+    return mazes;
+}
+
+/**
+ * Validates every maze file in a directory on a pool of threads. 
+ * Prints every problem found as "file:line:column: message" on the error output, 
+ * and a machine readable summary on the standard output or in a file.
+ * 
+ * Usage: --validate <directory> [--threads N] [--summary FILE]
+ * 
+ * @param args The command line arguments
+ * @returns The exit code, 0 if every maze is valid
+ */
+int validateCommand(const vector<string> &args)
+{
+    string directory = ".";
+    string summaryPath;
+    size_t threads = 0;
+
+    for (size_t i = 1; i < args.size(); i++)
+    {
+        if (args.at(i) == "--threads" && i + 1 < args.size())
+        {
+            if (!readCountOption(args, i, threads))
+            {
+                cerr << "Usage: --validate <directory> [--threads N] [--summary FILE]\n";
+                return 1;
+            }
+        }
+        else if (args.at(i) == "--summary" && i + 1 < args.size())
+            summaryPath = args.at(++i);
+        else
+            directory = args.at(i);
+    }
+
+    vector<string> paths;
+    error_code error;
+    for (const auto &entry : filesystem::directory_iterator(directory, error))
+    {
+        if (entry.is_regular_file() && isMazeFileName(entry.path().filename().string()))
+            paths.push_back(entry.path().string());
+    }
+
+    if (error)
+    {
+        cerr << directory << ": " << error.message() << '\n';
+        return 1;
+    }
+
+    sort(paths.begin(), paths.end());
+
+    vector<MazeReport> reports(paths.size());
+    auto start = chrono::steady_clock::now();
+
+    parallelFor(paths.size(), threads, [&](size_t i)
+                { validateMazeFile(paths.at(i), reports.at(i)); });
+
+    auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start);
+
+    size_t invalid = 0;
+    for (const MazeReport &report : reports)
+    {
+        invalid += !report.issues.empty();
+
+        for (const MazeIssue &issue : report.issues)
+            cerr << report.path << ':' << issue.line << ':' << issue.column << ": " << issue.message << '\n';
+    }
+
+    cerr << paths.size() << " mazes validated in " << elapsed.count() << "ms, " << invalid << " invalid\n";
+
+    if (summaryPath.empty())
+        printValidationSummary(cout, reports);
+    else
+    {
+        ofstream summary(summaryPath);
+        printValidationSummary(summary, reports);
+    }
+
+    return invalid != 0;
+}
+
+/**
+ * A playing strategy. 
+ * Receives a read-only view of the maze (fences, robots and player) and returns a movement key, in lower case.
+ */
+using BotStrategy = function<char(const Maze &maze)>;
+
+/**
+ * This struct represents a bot that can play the game.
+ */
+struct Bot
+{
+    /** The bot's name, used in reports */
+    string name;
+    /** How the bot plays */
+    BotStrategy strategy;
+};
+
+/**
+ * This struct holds what a bot would face after a move.
+ */
+struct MoveOutlook
+{
+    /** Whether the player survives the move and the robots' next step */
+    bool safe = true;
+    /** How many robots would step onto a fence */
+    size_t fenceKills = 0;
+    /** Distance to the closest robot that's alive after the move, in moves */
+    size_t closestRobot = SIZE_MAX;
+};
+
+/**
+ * Looks one turn ahead: where the player would be after a move and where each robot would step next. 
+ * Doesn't take collisions between robots into account.
+ * 
+ * @param maze The maze
+ * @param move The movement key
+ * @param outlook Where the result is stored
+ * 
+ * @returns false if the move is not allowed
+ */
+bool lookAhead(const Maze &maze, const char move, MoveOutlook &outlook)
+{
+    int columnDelta, lineDelta;
+    moveDelta(move, columnDelta, lineDelta);
+
+    const long column = long(maze.player.column) + columnDelta;
+    const long line = long(maze.player.line) + lineDelta;
+
+    if (column < 0 || line < 0 || size_t(column) >= maze.nCols || size_t(line) >= maze.nLines)
+        return false;
+
+    const Entity *occupant = robotAt(maze, column, line);
+    if (occupant && !occupant->alive)
+        return false;
+
+    if (occupant || isFence(maze, column, line))
+        outlook.safe = false;
+
+    for (const Entity &robot : maze.robots)
+    {
+        if (!robot.alive)
+            continue;
+
+        long nextColumn = long(robot.column) + sign(column - long(robot.column));
+        long nextLine = long(robot.line) + sign(line - long(robot.line));
+
+        if (isFence(maze, nextColumn, nextLine))
+            outlook.fenceKills++;
+        else if (nextColumn == column && nextLine == line)
+            outlook.safe = false;
+        else
+            outlook.closestRobot = min<size_t>(outlook.closestRobot, max(labs(nextColumn - column), labs(nextLine - line)));
+    }
+
+    return true;
+}
+
+/**
+ * Creates a strategy that picks the safe move scoring the most, 
+ * where each robot lured onto a fence is worth killWeight and each cell of distance to the closest robot is worth distanceWeight.
+ * 
+ * @param killWeight How much killing robots is worth
+ * @param distanceWeight How much keeping away from robots is worth
+ * 
+ * @returns The strategy
+ */
+BotStrategy scoringStrategy(const double killWeight, const double distanceWeight)
+{
+    return [=](const Maze &maze)
+    {
+        // Waiting comes first so it wins ties
+        static const string moves = "sqweadzxc"s;
+
+        char best = 's';
+        double bestScore = -1e300;
+
+        for (char move : moves)
+        {
+            MoveOutlook outlook;
+            if (!lookAhead(maze, move, outlook))
+                continue;
+
+            double distance = outlook.closestRobot == SIZE_MAX ? 0 : min<size_t>(outlook.closestRobot, maze.nCols + maze.nLines);
+            double score = killWeight * outlook.fenceKills + distanceWeight * distance - (outlook.safe ? 0 : 1e9);
+
+            if (score > bestScore)
+            {
+                best = move;
+                bestScore = score;
+            }
+        }
+
+        return best;
+    };
+}
+
+/**
+ * Gets every bot that takes part in tournaments.
+ * 
+ * @returns The bots
+ */
+vector<Bot> registeredBots()
+{
+    vector<Bot> bots;
+
+    // Only waits, like the solution to MAZE_02
+    bots.push_back({"waiter", [](const Maze &)
+                    { return 's'; }});
+
+    // Moves pseudo-randomly, but always the same way in the same situation
+    bots.push_back({"random", [](const Maze &maze)
+                    {
+                        static const string moves = "qweasdzxc"s;
+                        size_t hash = (maze.turn + 1) * 0x9E3779B97F4A7C15ull ^ maze.index(maze.player.column, maze.player.line);
+                        return moves.at((hash >> 7) % moves.length());
+                    }});
+
+    // Every combination of weights for the scoring strategy
+    for (double killWeight : {0.0, 1.0, 4.0})
+    {
+        for (double distanceWeight : {0.0, 0.25, 1.0})
+        {
+            if (killWeight == 0 && distanceWeight == 0)
+                continue;
+
+            stringstream name;
+            name << "score(kill=" << killWeight << ",distance=" << distanceWeight << ")";
+            bots.push_back({name.str(), scoringStrategy(killWeight, distanceWeight)});
+        }
+    }
+
+    return bots;
+}
+
+/**
+ * This struct holds the results of a bot on a maze.
+ */
+struct BotResult
+{
+    /** How many games were played */
+    size_t games = 0;
+    /** How many games were won */
+    size_t wins = 0;
+    /** How many games ran out of turns */
+    size_t timeouts = 0;
+    /** Turns played in the games that were won */
+    size_t turnsToWin = 0;
+    /** How many moves the bot chose */
+    size_t moves = 0;
+    /** How many moves were not allowed and replaced with waiting */
+    size_t invalidMoves = 0;
+    /** Time spent deciding moves */
+    chrono::nanoseconds decisionTime = chrono::nanoseconds(0);
+    /** Longest time spent deciding a single move */
+    chrono::nanoseconds slowestDecision = chrono::nanoseconds(0);
+
+    /**
+     * Adds the results of other games to these.
+     * 
+     * @param other The other results
+     */
+    void add(const BotResult &other)
+    {
+        games += other.games;
+        wins += other.wins;
+        timeouts += other.timeouts;
+        turnsToWin += other.turnsToWin;
+        moves += other.moves;
+        invalidMoves += other.invalidMoves;
+        decisionTime += other.decisionTime;
+        slowestDecision = max(slowestDecision, other.slowestDecision);
+    }
+};
+
+/**
+ * Plays a whole game with a bot, without showing anything.
+ * 
+ * @param maze The maze, as loaded, a copy is played
+ * @param bot The bot
+ * @param maxTurns After how many turns the game is stopped
+ * @param result Where the result of the game is added
+ * @param record If not null, where the game is stored for the maze's game log
+ */
+void playBotGame(const Maze &maze, const Bot &bot, const size_t maxTurns, BotResult &result, GameRecord *record = nullptr)
+{
+    Maze game = maze;
+    string errorMessage;
+
+    while (!isGameOver(game) && game.turn < maxTurns)
+    {
+        auto start = chrono::steady_clock::now();
+        char move = bot.strategy(game);
+        auto decision = chrono::steady_clock::now() - start;
+
+        result.moves++;
+        result.decisionTime += decision;
+        result.slowestDecision = max<chrono::nanoseconds>(result.slowestDecision, decision);
+
+        if (!playTurn(game, move, errorMessage))
+        {
+            result.invalidMoves++;
+            playTurn(game, 's', errorMessage);
+        }
+    }
+
+    result.games++;
+
+    if (record)
+        *record = {game.layout->hash, encodeMoves(game.moves)};
+
+    if (!isGameOver(game))
+        result.timeouts++;
+    else if (game.player.alive)
+    {
+        result.wins++;
+        result.turnsToWin += game.turn;
+    }
+}
+
+/**
+ * Plays every registered bot on every maze, on all cores, and ranks the bots. 
+ * With --record the games are also added to the mazes' game logs, for --analyze.
+ * 
+ * Usage: --tournament [--threads N] [--turns MAX] [--record] [maze numbers...]
+ * 
+ * @param args The command line arguments
+ * @returns The exit code
+ */
+int tournamentCommand(const vector<string> &args)
+{
+    size_t threads = 0;
+    size_t maxTurns = 1000;
+    bool record = false;
+    vector<string> mazeNumbers;
+
+    for (size_t i = 1; i < args.size(); i++)
+    {
+        if ((args.at(i) == "--threads" || args.at(i) == "--turns") && i + 1 < args.size())
+        {
+            if (!readCountOption(args, i, args.at(i) == "--threads" ? threads : maxTurns))
+            {
+                cerr << "Usage: --tournament [--threads N] [--turns MAX] [--record] [maze numbers...]\n";
+                return 1;
+            }
+        }
+        else if (args.at(i) == "--record")
+            record = true;
+        else
+            mazeNumbers.push_back(padMazeNumber(args.at(i)));
+    }
+
+    // Every maze in this directory by default
+    vector<Maze> mazes = loadToolMazes(mazeNumbers, [](const string &number)
+                                       { return filesystem::exists("MAZE_"s + number + ".txt"s) || filesystem::exists(tiledMazeFileName(number)); });
+
+    const vector<Bot> bots = registeredBots();
+    vector<BotResult> results(bots.size() * mazes.size());
+    vector<GameRecord> records(record ? results.size() : 0);
+
+    auto start = chrono::steady_clock::now();
+
+    parallelFor(results.size(), threads, [&](size_t i)
+                { playBotGame(mazes.at(i % mazes.size()), bots.at(i / mazes.size()), maxTurns, results.at(i), record ? &records.at(i) : nullptr); });
+
+    auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start);
+
+    // Every maze's games are written at once, after all of them are played
+    for (size_t m = 0; m < mazes.size() && record; m++)
     {
-        validInput = false;
-        errorMessage = INVALID_MAZE_NUMBER;
-        return true;
+        vector<GameRecord> mazeRecords;
+        for (size_t i = m; i < records.size(); i += mazes.size())
+            mazeRecords.push_back(records.at(i));
+
+        recordGames(mazes.at(m).mazeNumber, mazeRecords);
     }
 
-    if (!loadMaze(maze, validInput, errorMessage))
+    // Add up each bot's results
+    vector<BotResult> totals(bots.size());
+    vector<size_t> ranking(bots.size());
+    for (size_t i = 0; i < results.size(); i++)
+        totals.at(i / mazes.size()).add(results.at(i));
+    for (size_t i = 0; i < ranking.size(); i++)
+        ranking.at(i) = i;
+
+    // Most wins first, then fewest turns to win
+    sort(ranking.begin(), ranking.end(), [&](size_t b1, size_t b2)
+         {
+             const BotResult &r1 = totals.at(b1), &r2 = totals.at(b2);
+             if (r1.wins != r2.wins)
+                 return r1.wins > r2.wins;
+             return r1.turnsToWin * max<size_t>(r2.wins, 1) < r2.turnsToWin * max<size_t>(r1.wins, 1);
+         });
+
+    cout << setw(32) << left << "Bot" << right
+         << setw(8) << "Games" << setw(8) << "Win %" << setw(12) << "Turns/win"
+         << setw(10) << "Timeouts" << setw(10) << "Invalid" << setw(12) << "us/move" << setw(12) << "Max us" << '\n';
+
+    for (size_t b : ranking)
     {
-        return true;
+        const BotResult &total = totals.at(b);
+        auto micros = [](chrono::nanoseconds time)
+        { return chrono::duration<double, micro>(time).count(); };
+
+        cout << setw(32) << left << bots.at(b).name << right << fixed << setprecision(1)
+             << setw(8) << total.games
+             << setw(8) << 100.0 * total.wins / max<size_t>(total.games, 1)
+             << setw(12) << (total.wins ? double(total.turnsToWin) / total.wins : 0.0)
+             << setw(10) << total.timeouts << setw(10) << total.invalidMoves
+             << setprecision(3) << setw(12) << micros(total.decisionTime) / max<size_t>(total.moves, 1)
+             << setw(12) << micros(total.slowestDecision) << '\n';
     }
 
-    // Start the game
-    gameState = GameState::inGame;
-    maze.startTime = chrono::steady_clock::now();
-    return true;
+    cerr << results.size() << " games on " << mazes.size() << " mazes played in " << elapsed.count() << "ms\n";
+    return 0;
 }
 
 /**
- * Does a player move if it is valid.
- * If it's not, returns a useful error message.
+ * Re-plays a leaderboard entry's moves with the game rules to check it's a real win.
  * 
- * @param maze The maze
- * @param errorMessage The error message returned if the movement is invalid
- * @param columnDelta How many cells to move in the x axis
- * @param lineDelta How many cells to move in the y axis
+ * @param maze The maze, as loaded, a copy is played
+ * @param entry The leaderboard entry
  * 
- * @returns false if the movement is invalid
+ * @returns Why the entry is invalid, empty if it is valid
  */
-bool doPlayerMove(Maze &maze, string &errorMessage, int columnDelta, int lineDelta)
+string verifyEntry(const Maze &maze, const LeaderboardEntry &entry)
 {
-    int newCol = maze.player.column + columnDelta;
-    int newLine = maze.player.line + lineDelta;
+    if (entry.moves.empty())
+        return NO_PROOF;
 
-    if (newCol < 0 || newCol >= maze.nCols || newLine < 0 || newLine >= maze.nLines)
-    {
-        errorMessage = OUT_OF_BOUNDS;
-        return false;
-    }
-    else if (maze.visualMap.at(maze.index(newCol, newLine)) == 'r')
+    if (entry.mazeHash != maze.layout->hash)
+        return WRONG_MAZE;
+
+    if (entry.seal != proofSeal(entry))
+        return WRONG_ENTRY;
+
+    Maze game = maze;
+    string errorMessage;
+
+    // Real time games can't have more ticks or key presses than their time allows
+    const uint64_t milliseconds = (uint64_t(entry.points) + 1) * 1000;
+    const uint64_t tick = maze.layout->tickInterval.count();
+    uint64_t ticks = 0, keys = 0;
+    bool tooFast = false;
+
+    // The moves are played as they are decoded, so moves after the game ended are never stored
+    auto play = [&](const char move, const size_t count)
     {
-        errorMessage = CELL_OCCUPIED;
-        return false;
-    }
+        if (move == ROBOT_TICK)
+            ticks += count;
+        else if (isupper(static_cast<unsigned char>(move)))
+            keys += count;
 
-    maze.player.column = newCol;
-    maze.player.line = newLine;
-    return true;
+        tooFast = ticks * tick > milliseconds || keys > milliseconds / 1000 * MAX_KEYS_PER_SECOND;
+        return !tooFast && replayMoves(game, move, count, errorMessage);
+    };
+
+    const bool possible = decodeMoveRuns(entry.moves, play);
+
+    if (tooFast)
+        return WRONG_ENTRY;
+
+    if (!possible)
+        return INVALID_PROOF;
+
+    if (!isGameOver(game) || !game.player.alive)
+        return NOT_A_WIN;
+
+    return "";
 }
 
 /**
- * Asks the user for movement and does it if it's valid.
- * If it's invalid shows a helpful error message.
+ * Checks every entry of the leaderboards by re-playing their moves.
  * 
- * @param maze The maze
- * @param validInput Whether the input was valid
- * @param errorMessage The error message returned if the input is invalid
+ * Usage: --verify [--threads N] [maze numbers...]
  * 
- * @returns false if the user wants to exit the game
+ * @param args The command line arguments
+ * @returns The exit code, 0 if every entry is valid
  */
-bool movePlayer(Maze &maze, bool &validInput, string &errorMessage)
+int verifyCommand(const vector<string> &args)
 {
-    string input;
+    size_t threads = 0;
+    vector<string> mazeNumbers;
 
-    cout << "Insert movement: ";
+    for (size_t i = 1; i < args.size(); i++)
+    {
+        if (args.at(i) == "--threads" && i + 1 < args.size())
+        {
+            if (!readCountOption(args, i, threads))
+            {
+                cerr << "Usage: --verify [--threads N] [maze numbers...]\n";
+                return 1;
+            }
+        }
+        else
+            mazeNumbers.push_back(padMazeNumber(args.at(i)));
+    }
 
-    if (!getInput(input))
-        return false;
+    // Every leaderboard in this directory by default
+    vector<Maze> mazes = loadToolMazes(mazeNumbers, [](const string &number)
+                                       { return filesystem::exists("MAZE_"s + number + "_WINNERS.txt"s); });
+    vector<Leaderboard> leaderboards(mazes.size());
+    // Which maze and entry each verification is for
+    vector<pair<size_t, size_t>> entries;
 
-    if (input.length() != 1)
+    for (size_t m = 0; m < mazes.size(); m++)
     {
-        validInput = false;
-        errorMessage = GENERIC_ERROR;
-        return true;
+        readLeaderboard(mazes.at(m).mazeNumber, leaderboards.at(m));
+
+        for (size_t i = 0; i < leaderboards.at(m).size(); i++)
+            entries.push_back({m, i});
     }
 
-    char move = tolower(input.at(0));
+    vector<string> verdicts(entries.size());
+    auto start = chrono::steady_clock::now();
+
+    parallelFor(entries.size(), threads, [&](size_t i)
+                {
+                    auto [maze, entry] = entries.at(i);
+                    verdicts.at(i) = verifyEntry(mazes.at(maze), leaderboards.at(maze).at(entry));
+                });
 
-    switch (move)
+    auto elapsed = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start);
+
+    size_t rejected = 0;
+    for (size_t i = 0; i < entries.size(); i++)
     {
-    case 'q':
-        validInput = doPlayerMove(maze, errorMessage, -1, -1);
-        return true;
-    case 'w':
-        validInput = doPlayerMove(maze, errorMessage, 0, -1);
-        return true;
-    case 'e':
-        validInput = doPlayerMove(maze, errorMessage, 1, -1);
-        return true;
-    case 'a':
-        validInput = doPlayerMove(maze, errorMessage, -1, 0);
-        return true;
-    case 's':
-        validInput = doPlayerMove(maze, errorMessage, 0, 0);
-        return true;
-    case 'd':
-        validInput = doPlayerMove(maze, errorMessage, 1, 0);
-        return true;
-    case 'z':
-        validInput = doPlayerMove(maze, errorMessage, -1, 1);
-        return true;
-    case 'x':
-        validInput = doPlayerMove(maze, errorMessage, 0, 1);
-        return true;
-    case 'c':
-        validInput = doPlayerMove(maze, errorMessage, 1, 1);
-        return true;
-    default:
-        validInput = false;
-        errorMessage = GENERIC_ERROR;
-        return true;
+        if (verdicts.at(i).empty())
+            continue;
+
+        auto [maze, entry] = entries.at(i);
+        const LeaderboardEntry &person = leaderboards.at(maze).at(entry);
+
+        cout << "MAZE_" << mazes.at(maze).mazeNumber << "_WINNERS.txt: " << person.name << " - "
+             << setw(4) << person.points << ": " << verdicts.at(i) << '\n';
+        rejected++;
     }
+
+    cerr << entries.size() << " entries verified in " << elapsed.count() / 1000.0 << "ms, " << rejected << " rejected\n";
+    return rejected != 0;
 }
 
 /**
- * Checks if two entities occupy the same cell.
- * 
- * @param e1 The first entity
- * @param e2 The second entity
- * 
- * @returns true if the entities collided
+ * This struct holds what happened in the games recorded on a maze, see analyzeCommand.
  */
-bool entityEntityCollision(const Entity &e1, const Entity &e2)
+struct MazeStats
 {
-    return e1.line == e2.line && e1.column == e2.column;
-}
+    /** How many games were won */
+    size_t wins = 0;
+    /** How many games were lost */
+    size_t losses = 0;
+    /** How many games were stopped before they ended */
+    size_t unfinished = 0;
+    /** How many games were played on a different maze or have impossible moves */
+    size_t invalid = 0;
+    /** How many times the player died on a fence */
+    size_t playerFenceDeaths = 0;
+    /** How many times the player was caught by a robot */
+    size_t playerRobotDeaths = 0;
+    /** How many times the player went into each cell, including where they start */
+    vector<uint32_t> visits;
+    /** How many times the player died in each cell */
+    vector<uint32_t> playerDeaths;
+    /** How many robots died on the fence of each cell */
+    vector<uint32_t> fenceDeaths;
+    /** How many robots died colliding with other robots in each cell */
+    vector<uint32_t> collisionDeaths;
+    /** How many times each robot caught the player */
+    vector<uint32_t> kills;
+    /** How many games were won after each number of turns */
+    vector<uint32_t> winTurns;
+    /** How many games were lost after each number of turns */
+    vector<uint32_t> lossTurns;
+
+    /**
+     * Adds the stats of other games on the same maze to these.
+     * 
+     * @param other The other stats
+     */
+    void add(const MazeStats &other)
+    {
+        wins += other.wins;
+        losses += other.losses;
+        unfinished += other.unfinished;
+        invalid += other.invalid;
+        playerFenceDeaths += other.playerFenceDeaths;
+        playerRobotDeaths += other.playerRobotDeaths;
+
+        auto addCounts = [](vector<uint32_t> &counts, const vector<uint32_t> &otherCounts)
+        {
+            if (counts.size() < otherCounts.size())
+                counts.resize(otherCounts.size(), 0);
+            for (size_t i = 0; i < otherCounts.size(); i++)
+                counts[i] += otherCounts[i];
+        };
+
+        addCounts(visits, other.visits);
+        addCounts(playerDeaths, other.playerDeaths);
+        addCounts(fenceDeaths, other.fenceDeaths);
+        addCounts(collisionDeaths, other.collisionDeaths);
+        addCounts(kills, other.kills);
+        addCounts(winTurns, other.winTurns);
+        addCounts(lossTurns, other.lossTurns);
+    }
+};
 
 /**
- * Checks if an entity occupies the same cell as a fence.
- * 
- * @param entity The entity
- * @param maze The second entity
+ * This struct hands out blocks of recorded games to the threads analyzing them, see analyzeCommand. 
+ * The games are read while they are analyzed, and only a few blocks wait at once.
+ */
+struct AnalysisQueue
+{
+    /** Protects the queue */
+    mutex lock;
+    /** Signalled when a block is added or taken, or the games run out */
+    condition_variable changed;
+    /** The blocks waiting, each with the index of its maze */
+    deque<pair<size_t, vector<GameRecord>>> blocks;
+    /** Whether every game was read */
+    bool finished = false;
+};
+
+/**
+ * Re-plays a recorded game with the game rules and adds what happened to a maze's stats.
  * 
- * @returns true if the entities collided
+ * @param maze The maze, as loaded, a copy is played
+ * @param record The game
+ * @param stats Where the game is added
+ * @param path Used to store the cells the player went into, reused between games to avoid allocating
  */
-bool entityFenceCollision(const Entity &entity, const Maze &maze)
+void analyzeGame(const Maze &maze, const GameRecord &record, MazeStats &stats, vector<size_t> &path)
 {
-    return maze.fenceMap.at(maze.index(entity.column, entity.line)) == '*';
+    Maze game = maze;
+    string errorMessage;
+
+    path.assign(1, game.index(game.player.column, game.player.line));
+
+    // The moves are played as they are decoded, so moves after the game ended are never stored
+    auto play = [&](const char move, const size_t count)
+    {
+        // The player stays put while waiting
+        if (move == 's')
+            return replayMoves(game, move, count, errorMessage);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            if (!replayMoves(game, move, 1, errorMessage))
+                return false;
+
+            const size_t cell = game.index(game.player.column, game.player.line);
+            if (cell != path.back())
+                path.push_back(cell);
+        }
+
+        return true;
+    };
+
+    if (record.mazeHash != maze.layout->hash || !decodeMoveRuns(record.moves, play))
+    {
+        stats.invalid++;
+        return;
+    }
+
+    const size_t cells = game.nLines * game.nCols;
+    if (stats.visits.empty())
+    {
+        stats.visits.assign(cells, 0);
+        stats.playerDeaths.assign(cells, 0);
+        stats.fenceDeaths.assign(cells, 0);
+        stats.collisionDeaths.assign(cells, 0);
+        stats.kills.assign(game.robots.size(), 0);
+    }
+
+    for (size_t cell : path)
+        stats.visits[cell]++;
+
+    // Dead robots stay where they died, on the fence or on the robot they ran into
+    for (size_t i = 0; i < game.robots.size(); i++)
+    {
+        const Entity &robot = game.robots[i];
+        if (robot.alive)
+            continue;
+
+        const size_t cell = game.index(robot.column, robot.line);
+        if (isFence(game, robot.column, robot.line))
+            stats.fenceDeaths[cell]++;
+        else
+            stats.collisionDeaths[cell]++;
+    }
+
+    if (!isGameOver(game))
+    {
+        stats.unfinished++;
+        return;
+    }
+
+    vector<uint32_t> &turns = game.player.alive ? stats.winTurns : stats.lossTurns;
+    if (turns.size() <= game.turn)
+        turns.resize(game.turn + 1, 0);
+    turns[game.turn]++;
+
+    if (game.player.alive)
+    {
+        stats.wins++;
+        return;
+    }
+
+    stats.losses++;
+    stats.playerDeaths[path.back()]++;
+
+    if (isFence(game, game.player.column, game.player.line))
+    {
+        stats.playerFenceDeaths++;
+        return;
+    }
+
+    stats.playerRobotDeaths++;
+
+    // The robot that caught the player is alive in their cell, unless it was already dead there
+    size_t killer = SIZE_MAX;
+    for (size_t i = 0; i < game.robots.size(); i++)
+    {
+        const Entity &robot = game.robots[i];
+        if (entityEntityCollision(robot, game.player) && (killer == SIZE_MAX || robot.alive))
+            killer = i;
+    }
+
+    if (killer != SIZE_MAX)
+        stats.kills[killer]++;
 }
 
 /**
- * Moves the robots that are alive in sequential order.
- * Also checks for collisions between robots, robots and fences, and robots and the player.
+ * Writes a maze's heatmaps to a compact binary file:
+ * - A header with the magic, the version, the maze size and how many games were analyzed
+ * - The player's visits, the player's deaths, the robots' deaths on fences and the robots' deaths in collisions,
+ *   each a grid of 32 bit counts, one per cell, line by line
+ * - How many robots there are and how many times each one caught the player, as 32 bit counts
  * 
+ * @param path Where to write the file
  * @param maze The maze
+ * @param stats The maze's stats
+ * 
+ * @returns false if the file could not be written
  */
-void moveRobots(Maze &maze)
+bool writeHeatmaps(const string &path, const Maze &maze, const MazeStats &stats)
 {
-    for (Entity &robot : maze.robots)
+    ofstream file(path, ios::binary);
+    const uint64_t games = stats.wins + stats.losses + stats.unfinished;
+
+    file.write(HEATMAP_MAGIC.data(), HEATMAP_MAGIC.length());
+    file.write(reinterpret_cast<const char *>(&HEATMAP_VERSION), sizeof(HEATMAP_VERSION));
+    for (uint64_t value : {uint64_t(maze.nLines), uint64_t(maze.nCols), games})
+        file.write(reinterpret_cast<const char *>(&value), sizeof(value));
+
+    // Mazes without valid games have empty stats
+    const vector<uint32_t> none(maze.nLines * maze.nCols, 0);
+    for (const vector<uint32_t> *grid : {&stats.visits, &stats.playerDeaths, &stats.fenceDeaths, &stats.collisionDeaths})
     {
-        if (!robot.alive)
-            continue;
+        const vector<uint32_t> &counts = grid->empty() ? none : *grid;
+        file.write(reinterpret_cast<const char *>(counts.data()), counts.size() * sizeof(uint32_t));
+    }
 
-        robot.line += sign(maze.player.line - robot.line);
-        robot.column += sign(maze.player.column - robot.column);
+    const vector<uint32_t> kills = stats.kills.empty() ? vector<uint32_t>(maze.robots.size(), 0) : stats.kills;
+    const uint64_t robots = kills.size();
+    file.write(reinterpret_cast<const char *>(&robots), sizeof(robots));
+    file.write(reinterpret_cast<const char *>(kills.data()), kills.size() * sizeof(uint32_t));
 
-        robot.alive = !entityFenceCollision(robot, maze);
+    return file.good();
+}
 
-        for (Entity &other : maze.robots)
+/**
+ * Writes the stats of every maze as JSON.
+ * 
+ * @param out Where to write
+ * @param mazes The mazes
+ * @param stats Every maze's stats
+ */
+void printAnalysisSummary(ostream &out, const vector<Maze> &mazes, const vector<MazeStats> &stats)
+{
+    // Turn counts as {"turns":games}, only the ones that happened
+    auto printTurns = [&](const vector<uint32_t> &turns)
+    {
+        out << '{';
+        bool first = true;
+        for (size_t i = 0; i < turns.size(); i++)
         {
-            if (&robot == &other)
+            if (turns[i] == 0)
                 continue;
+            out << (first ? "" : ",") << '"' << i << "\":" << turns[i];
+            first = false;
+        }
+        out << '}';
+    };
 
-            if (entityEntityCollision(robot, other))
-            {
-                robot.alive = false;
-                other.alive = false;
-            }
+    auto total = [](const vector<uint32_t> &counts)
+    {
+        size_t sum = 0;
+        for (uint32_t count : counts)
+            sum += count;
+        return sum;
+    };
+
+    out << "{\"mazes\":" << mazes.size() << ",\"results\":[";
+
+    for (size_t m = 0; m < mazes.size(); m++)
+    {
+        const Maze &maze = mazes.at(m);
+        const MazeStats &mazeStats = stats.at(m);
+
+        // Cells the player could have gone into but no one ever did
+        size_t unvisited = 0;
+        for (size_t i = 0; i < maze.nLines * maze.nCols; i++)
+            unvisited += (mazeStats.visits.empty() || mazeStats.visits[i] == 0) && !isFence(maze, i % maze.nCols, i / maze.nCols);
+
+        out << (m ? "," : "") << "\n{\"maze\":\"" << maze.mazeNumber << "\""
+            << ",\"games\":" << mazeStats.wins + mazeStats.losses + mazeStats.unfinished
+            << ",\"wins\":" << mazeStats.wins << ",\"losses\":" << mazeStats.losses
+            << ",\"unfinished\":" << mazeStats.unfinished << ",\"invalid\":" << mazeStats.invalid
+            << ",\"playerDeaths\":{\"fence\":" << mazeStats.playerFenceDeaths << ",\"robot\":" << mazeStats.playerRobotDeaths << '}'
+            << ",\"robotDeaths\":{\"fence\":" << total(mazeStats.fenceDeaths) << ",\"collision\":" << total(mazeStats.collisionDeaths) << '}'
+            << ",\"unvisitedCells\":" << unvisited << ",\"kills\":[";
+
+        // The robots that caught the player, most kills first
+        vector<size_t> killers;
+        for (size_t i = 0; i < mazeStats.kills.size(); i++)
+        {
+            if (mazeStats.kills[i])
+                killers.push_back(i);
         }
+        sort(killers.begin(), killers.end(), [&](size_t r1, size_t r2)
+             { return mazeStats.kills[r1] > mazeStats.kills[r2]; });
 
-        if (entityEntityCollision(robot, maze.player))
+        for (size_t k = 0; k < killers.size(); k++)
         {
-            maze.player.alive = false;
+            const Entity &robot = maze.layout->robots.at(killers[k]);
+            out << (k ? "," : "") << "{\"robot\":" << killers[k] << ",\"line\":" << robot.line + 1
+                << ",\"column\":" << robot.column + 1 << ",\"kills\":" << mazeStats.kills[killers[k]] << '}';
         }
+
+        out << "],\"winTurns\":";
+        printTurns(mazeStats.winTurns);
+        out << ",\"lossTurns\":";
+        printTurns(mazeStats.lossTurns);
+        out << '}';
     }
+
+    out << "\n]}\n";
 }
 
 /**
- * Checks if the game has ended, either because all robots are dead or because the player is dead.
+ * Re-plays every game recorded on the mazes, on all cores, and writes where players went and died 
+ * and where robots died as heatmaps, see writeHeatmaps, plus a summary with death causes and turn counts. 
+ * Each thread adds games up in its own stats, which are then added together maze by maze.
  * 
- * @param maze The maze
+ * Usage: --analyze [--threads N] [--output DIRECTORY] [--summary FILE] [maze numbers...]
  * 
- * @returns true if the game is over
+ * @param args The command line arguments
+ * @returns The exit code
  */
-bool isGameOver(const Maze &maze)
+int analyzeCommand(const vector<string> &args)
 {
-    bool allDead = true;
-    for (const Entity &robot : maze.robots)
+    size_t threads = 0;
+    string directory = ".";
+    string summaryPath;
+    vector<string> mazeNumbers;
+
+    for (size_t i = 1; i < args.size(); i++)
     {
-        if (robot.alive)
+        if (args.at(i) == "--threads" && i + 1 < args.size())
         {
-            allDead = false;
-            break;
+            if (!readCountOption(args, i, threads))
+            {
+                cerr << "Usage: --analyze [--threads N] [--output DIRECTORY] [--summary FILE] [maze numbers...]\n";
+                return 1;
+            }
         }
+        else if (args.at(i) == "--output" && i + 1 < args.size())
+            directory = args.at(++i);
+        else if (args.at(i) == "--summary" && i + 1 < args.size())
+            summaryPath = args.at(++i);
+        else
+            mazeNumbers.push_back(padMazeNumber(args.at(i)));
     }
 
-    return allDead || !maze.player.alive;
-}
+    vector<Maze> mazes;
 
-/**
- * Updates the maze's visualMap with the robots and the player.
- * 
- * @param maze The maze
- */
-void updateVisualMap(Maze &maze)
-{
-    maze.visualMap = maze.fenceMap;
+    // Every game log in this directory by default
+    for (Maze &maze : loadToolMazes(mazeNumbers, [](const string &number)
+                                    { return filesystem::exists(gameLogFileName(number)); }))
+    {
+        if (maze.layout->tiles)
+        {
+            cerr << "Skipping maze " << maze.mazeNumber << ": " << TILED_HEATMAPS << '\n';
+            continue;
+        }
 
-    for (const Entity &r : maze.robots)
+        mazes.push_back(move(maze));
+    }
+
+    const size_t workers = threads ? threads : max(thread::hardware_concurrency(), 1u);
+    vector<vector<MazeStats>> partials(workers, vector<MazeStats>(mazes.size()));
+    AnalysisQueue queue;
+    size_t games = 0;
+
+    auto start = chrono::steady_clock::now();
+
+    // Games are handed out in blocks, so threads rarely wait for each other, and never share stats
+    auto analyze = [&](const size_t worker)
+    {
+        vector<size_t> path;
+
+        while (true)
+        {
+            pair<size_t, vector<GameRecord>> block;
+            {
+                unique_lock<mutex> lock(queue.lock);
+                queue.changed.wait(lock, [&]()
+                                   { return !queue.blocks.empty() || queue.finished; });
+                if (queue.blocks.empty())
+                    return;
+
+                block = move(queue.blocks.front());
+                queue.blocks.pop_front();
+            }
+            queue.changed.notify_all();
+
+            for (const GameRecord &record : block.second)
+                analyzeGame(mazes[block.first], record, partials[worker][block.first], path);
+        }
+    };
+
+    vector<thread> pool;
+    for (size_t worker = 0; worker < workers; worker++)
+        pool.emplace_back(analyze, worker);
+
+    // This thread reads the game logs, waiting when the analysis falls behind
+    auto hand = [&](const size_t maze, vector<GameRecord> &block)
+    {
+        {
+            unique_lock<mutex> lock(queue.lock);
+            queue.changed.wait(lock, [&]()
+                               { return queue.blocks.size() < ANALYSIS_QUEUE_SIZE; });
+            queue.blocks.emplace_back(maze, move(block));
+        }
+        queue.changed.notify_all();
+        block.clear();
+    };
+
+    for (size_t m = 0; m < mazes.size(); m++)
+    {
+        ifstream file(gameLogFileName(mazes[m].mazeNumber));
+        vector<GameRecord> block;
+        GameRecord record;
+
+        while (readGameRecord(file, record))
+        {
+            block.push_back(move(record));
+            games++;
+
+            if (block.size() == ANALYSIS_BLOCK_SIZE)
+                hand(m, block);
+        }
+
+        if (!block.empty())
+            hand(m, block);
+    }
+
+    {
+        lock_guard<mutex> lock(queue.lock);
+        queue.finished = true;
+    }
+    queue.changed.notify_all();
+
+    for (thread &t : pool)
+        t.join();
+
+    // Each maze's stats are added up on its own thread
+    vector<MazeStats> stats(mazes.size());
+    parallelFor(mazes.size(), threads, [&](size_t maze)
+                {
+                    for (vector<MazeStats> &partial : partials)
+                    {
+                        stats[maze].add(partial[maze]);
+                        partial[maze] = MazeStats();
+                    }
+                });
+
+    auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start);
+
+    int code = 0;
+    for (size_t m = 0; m < mazes.size(); m++)
+    {
+        string path = (filesystem::path(directory) / ("MAZE_"s + mazes[m].mazeNumber + "_HEATMAP.bin"s)).string();
+        if (!writeHeatmaps(path, mazes[m], stats[m]))
+        {
+            cerr << path << ": could not write heatmaps\n";
+            code = 1;
+        }
+    }
+
+    cerr << games << " games on " << mazes.size() << " mazes analyzed in " << elapsed.count() << "ms\n";
+
+    if (summaryPath.empty())
+        printAnalysisSummary(cout, mazes, stats);
+    else
     {
-        maze.visualMap.at(r.line * maze.nCols + r.column) = r.alive ? 'R' : 'r';
+        ofstream summary(summaryPath);
+        printAnalysisSummary(summary, mazes, stats);
     }
 
-    maze.visualMap.at(maze.player.line * maze.nCols + maze.player.column) = maze.player.alive ? 'H' : 'h';
+    return code;
 }
 
 /**
- * Prints the maze's visualMap.
+ * Gets the name of a game state, for trace exports.
  * 
- * @param maze The maze
+ * @param state The game state, as stored in a trace event
+ * @returns The name
  */
-void displayMaze(const Maze &maze)
+const char *gameStateName(const uint32_t state)
 {
-    for (size_t i = 0; i < maze.visualMap.size(); i++)
-    {
-        if (i % maze.nCols == 0)
-            cout << '\n';
-
-        cout << maze.visualMap.at(i);
-    }
-    cout << '\n';
+    static const char *names[] = {"mainMenu", "mazeMenu", "inGame", "finished"};
+    return state < 4 ? names[state] : "unknown";
 }
 
 /**
- * Handles in game logic:
- * - Shows the maze
- * - Asks the player for input and moves him
- * - Moves the robots
- * - Handles collisions
+ * Converts a maze file to a tiled file, so it can be played without keeping all its fences in memory. 
+ * The maze is read a band of tiles at a time, and only tiles with fences are written. The tiled file has:
+ * - A header with the maze size, tick interval, hash, player and robot count
+ * - Where each tile is in the file, 0 if the tile has no fences
+ * - The tiles with fences, one bit per cell, a 64 bit row per line
+ * - The robots' positions, as map indices
  * 
- * @param gameState The state the game is in
- * @param maze The maze
- * @param validInput Whether the last input was valid
- * @param errorMessage The error message returned if the input was invalid
+ * @param mazeNumber The maze number (in the range "01" to "99")
+ * @param storedTiles Set to how many tiles were written
+ * @param errorMessage The reason why the maze could not be converted
  * 
- * @returns false if the user wants to exit the game
+ * @returns false if the maze was not converted
  */
-bool inGame(GameState &gameState, Maze &maze, bool &validInput, string &errorMessage)
+bool tileMaze(const string &mazeNumber, size_t &storedTiles, string &errorMessage)
 {
-    // Show maze
-    if (validInput)
+    ifstream file("MAZE_"s + mazeNumber + ".txt"s, ios::binary);
+    if (!file.is_open())
     {
-        updateVisualMap(maze);
-        displayMaze(maze);
+        errorMessage = MAZE_NOT_FOUND;
+        return false;
     }
 
-    // Check if game is over
-    if (isGameOver(maze))
-    {
-        gameState = GameState::finished;
-        return true;
-    }
+    // Same header as readMazeLayout
+    size_t nLines = 0, nCols = 0;
+    chrono::milliseconds tickInterval = DEFAULT_TICK_INTERVAL;
+    bool smartRobots = false;
+    char x;
+    string options;
 
-    if (!movePlayer(maze, validInput, errorMessage))
+    file >> nLines >> x >> nCols;
+    if (x != 'x' || file.fail() || !getline(file, options) || !parseMazeOptions(options, tickInterval, smartRobots))
+    {
+        errorMessage = INVALID_MAZE_HEADER_SIZE;
         return false;
-    if (!validInput)
-        return true;
+    }
 
-    if (entityFenceCollision(maze.player, maze) || maze.visualMap.at(maze.index(maze.player.column, maze.player.line)) == 'R')
+    if (smartRobots)
     {
-        maze.player.alive = false;
-        return true;
+        errorMessage = TILED_SMART_ROBOTS;
+        return false;
     }
 
-    moveRobots(maze);
+    const size_t cells = nLines * nCols;
+    const size_t tileCols = (nCols + TILE_SIZE - 1) / TILE_SIZE;
+    vector<uint64_t> offsets((nLines + TILE_SIZE - 1) / TILE_SIZE * tileCols, 0);
+    const uint64_t headerSize = TILED_MAGIC.length() + sizeof(TILED_VERSION) + 7 * sizeof(uint64_t);
 
-    return true;
-}
+    const string fileName = tiledMazeFileName(mazeNumber);
+    const string tempFileName = fileName + ".tmp"s;
+    ofstream out(tempFileName, ios::binary);
 
-/**
- * Reads a leaderboard file.
- * 
- * @param mazeNumber Which maze to read (in the range "01" to "99")
- * @param leaderboard Variable where the leaderboard is stored
- */
-void readLeaderboard(const string &mazeNumber, Leaderboard &leaderboard)
-{
-    ifstream file("MAZE_"s + mazeNumber + "_WINNERS.txt"s);
+    auto write = [&](const uint64_t value)
+    {
+        out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+    };
 
-    // File doesn't exist
-    if (!file.is_open())
-        return;
+    error_code error;
+    auto fail = [&](const string &message)
+    {
+        errorMessage = message;
+        out.close();
+        filesystem::remove(tempFileName, error);
+        return false;
+    };
 
-    // Ignore header
-    file.ignore(100, '\n');
-    file.ignore(100, '\n');
+    // Where each tile is goes after the header, it's written once every tile is
+    out.seekp(headerSize + offsets.size() * sizeof(uint64_t));
 
-    string line;
-    while (getline(file, line))
-    {
-        stringstream linestream(line);
-        LeaderboardEntry person;
-        size_t nameLength = 0;
-        char c;
+    // The tiles of the lines being read, one row per line of each tile
+    vector<uint64_t> band(tileCols * TILE_SIZE, 0);
+    size_t bandNumber = 0;
+    storedTiles = 0;
 
-        while (nameLength < 15)
+    auto writeBand = [&]()
+    {
+        for (size_t t = 0; t < tileCols; t++)
         {
-            c = linestream.get();
-            nameLength += isUtf8Byte1(c);
-            person.name += c;
+            auto first = band.begin() + t * TILE_SIZE, last = first + TILE_SIZE;
+            if (all_of(first, last, [](uint64_t row) { return row == 0; }))
+                continue;
+
+            offsets[bandNumber * tileCols + t] = out.tellp();
+            out.write(reinterpret_cast<const char *>(&*first), TILE_SIZE * sizeof(uint64_t));
+            storedTiles++;
         }
 
-        // Ignore dash
-        linestream >> c >> person.points;
-        leaderboard.push_back(person);
-    }
+        fill(band.begin(), band.end(), 0);
+    };
 
-    file.close();
-}
+    uint64_t hash = startMazeHash(nLines, nCols);
+    uint64_t player = UINT64_MAX;
+    vector<uint64_t> robots;
+    size_t i = 0;
 
-/**
- * Function used with std::sort to sort a leaderboard by points.
- * 
- * @param person1 The first person
- * @param person2 The second person
- * 
- * @returns true if the second person's points are greater than the first's
- */
-bool compareLeaderboardPoints(LeaderboardEntry person1, LeaderboardEntry person2)
-{
-    return (person1.points < person2.points);
-}
+    // Big mazes are read in chunks, not a character at a time
+    vector<char> chunk(1 << 20);
+    while (file.read(chunk.data(), chunk.size()) || file.gcount() > 0)
+    {
+        for (streamsize k = 0; k < file.gcount(); k++)
+        {
+            const char c = chunk[k];
+            if (c == '\n')
+                continue;
 
-/**
- * Sorts a leaderboard by points.
- * 
- * @param leaderboard The leaderboard
- */
-void sortLeaderboard(Leaderboard &leaderboard)
-{
-    sort(leaderboard.begin(), leaderboard.end(), compareLeaderboardPoints);
-}
+            if (c != ' ' && c != '*' && c != 'R' && c != 'H')
+                return fail(INVALID_MAZE_CHARACTER);
+            if (i >= cells)
+                return fail(INVALID_MAZE_SIZE);
+            if (c == 'H' && player != UINT64_MAX)
+                return fail(MULTIPLE_PLAYERS);
 
-/**
- * Prints a formated leaderboard onto an output stream.
- * 
- * @param out Where to print the leaderboard
- * @param leaderboard The leaderboard
- */
-void printLeaderboard(ostream &out, Leaderboard &leaderboard)
-{
-    out << "Player          - Time\n----------------------\n";
+            const size_t line = i / nCols, column = i % nCols;
+            if (line / TILE_SIZE != bandNumber)
+            {
+                writeBand();
+                bandNumber = line / TILE_SIZE;
+            }
 
-    for (auto person : leaderboard)
-    {
-        out << person.name << " - " << setw(4) << right << person.points << '\n';
+            if (c == '*')
+                band[column / TILE_SIZE * TILE_SIZE + line % TILE_SIZE] |= 1ull << (column % TILE_SIZE);
+            else if (c == 'R')
+                robots.push_back(i);
+            else if (c == 'H')
+                player = i;
+
+            hashByte(hash, static_cast<unsigned char>(c));
+            i++;
+        }
     }
-}
+    writeBand();
 
-/**
- * Saves a formated leaderboard onto a file.
- * 
- * @param mazeNumber Which maze file to save to (in the range "01" to "99")
- * @param leaderboard The leaderboard
- */
-void saveLeaderboard(const string &mazeNumber, Leaderboard &leaderboard)
-{
-    string fileName = "MAZE_"s + mazeNumber + "_WINNERS.txt"s;
+    if (player == UINT64_MAX)
+        return fail(NO_PLAYER);
+    if (i != cells)
+        return fail(INVALID_MAZE_SIZE);
 
-    ofstream file;
-    file.open(fileName);
+    const uint64_t robotsOffset = out.tellp();
+    for (uint64_t robot : robots)
+        write(robot);
+
+    out.seekp(0);
+    out.write(TILED_MAGIC.data(), TILED_MAGIC.length());
+    out.write(reinterpret_cast<const char *>(&TILED_VERSION), sizeof(TILED_VERSION));
+    for (uint64_t value : {uint64_t(nLines), uint64_t(nCols), uint64_t(tickInterval.count()), hash, player, uint64_t(robots.size()), robotsOffset})
+        write(value);
+    for (uint64_t offset : offsets)
+        write(offset);
+    out.close();
+
+    if (out.good())
+        filesystem::rename(tempFileName, fileName, error);
+
+    if (!out.good() || error)
+        return fail(TILED_WRITE_FAILED);
 
-    printLeaderboard(file, leaderboard);
+    return true;
 }
 
 /**
- * Searches the leaderboard for an entry with the same name. 
- * If it's found, asks the user if they want to use it or change it.
+ * Converts mazes to tiled files, which are then played instead of the maze files, see tileMaze.
  * 
- * @param leaderboard The leaderboard
- * @param person The person with the name to search for
- * @param validInput Whether the last input was valid. Is set to false if an entry with the name is found
- * @param errorMessage The error message returned if the input was invalid
+ * Usage: --tile <mazes...>
  * 
- * @returns false if the user wants to exit the game
+ * @param args The command line arguments
+ * @returns The exit code
  */
-bool searchSameName(Leaderboard &leaderboard, const LeaderboardEntry &person, bool &validInput, string &errorMessage)
+int tileCommand(const vector<string> &args)
 {
-    for (auto &other : leaderboard)
+    if (args.size() < 2)
     {
-        if (other.name == person.name)
-        {
-            cout << "That name already exits in the leaderboard! Do you wish to continue with it? (y/N) ";
-
-            string decision;
+        cerr << "Usage: --tile <mazes...>\n";
+        return 1;
+    }
 
-            if (!getInput(decision))
-                return false;
+    int code = 0;
+    for (size_t i = 1; i < args.size(); i++)
+    {
+        string number = padMazeNumber(args.at(i));
+        string errorMessage = validMazeNumber(number) ? ""s : INVALID_MAZE_NUMBER;
+        size_t storedTiles = 0;
 
-            if (decision == "y" || decision == "Y")
-            {
-                // Only save new score if it's better than the current one
-                if (person.points < other.points)
-                    other.points = person.points;
-            }
-            else
-            {
-                validInput = false;
-                errorMessage = ANOTHER_NAME;
-            }
-            return true;
+        if (errorMessage.empty() && tileMaze(number, storedTiles, errorMessage))
+            cout << tiledMazeFileName(number) << ": " << storedTiles << " tiles with fences\n";
+        else
+        {
+            cerr << "MAZE_" << number << ".txt: " << errorMessage << '\n';
+            code = 1;
         }
     }
 
-    leaderboard.push_back(person);
-    return true;
+    return code;
 }
 
 /**
- * Shows the game result.
- * If the player won asks for his name and saves it on the leaderboard.
+ * Converts a binary trace file to the Trace Event Format used by trace viewers such as chrome://tracing and Perfetto. 
+ * Game states become spans, everything else becomes instant events.
  * 
- * @param gameState The state the game is in
- * @param maze The maze
- * @param validInput Whether the last input was valid
- * @param errorMessage The error message returned if the input was invalid
+ * Usage: --trace-export <trace file> <json file>
  * 
- * @returns false if the user wants to exit the game
+ * @param args The command line arguments
+ * @returns The exit code
  */
-bool finished(GameState &gameState, const Maze &maze, bool &validInput, string &errorMessage)
+int traceExportCommand(const vector<string> &args)
 {
-    if (maze.player.alive)
+    if (args.size() != 3)
     {
-        if (validInput)
-            cout << "You win!\n";
-
-        cout << "Please insert your name: ";
-
-        LeaderboardEntry person;
-        Leaderboard leaderboard;
+        cerr << "Usage: --trace-export <trace file> <json file>\n";
+        return 1;
+    }
 
-        // Save points as soon as possible
-        person.points = chrono::duration_cast<chrono::seconds>(chrono::steady_clock::now() - maze.startTime).count();
+    ifstream in(args.at(1), ios::binary);
+    string magic(TRACE_MAGIC.length(), 0);
+    uint32_t version = 0;
+    uint64_t startTime = 0;
 
-        if (!getInput(person.name))
-            return false;
+    in.read(&magic[0], magic.length());
+    in.read(reinterpret_cast<char *>(&version), sizeof(version));
+    in.read(reinterpret_cast<char *>(&startTime), sizeof(startTime));
 
-        // Check name length
-        size_t nameLength = utf8Length(person.name);
-        if (nameLength > 15)
-        {
-            validInput = false;
-            errorMessage = INVALID_NAME;
-            return true;
-        }
-        else if (nameLength == 0)
-        {
-            validInput = false;
-            errorMessage = GENERIC_ERROR;
-            return true;
-        }
-        validInput = true;
-        // Name is valid, pad it out to a length of 15
-        person.name += string(15 - nameLength, ' ');
+    if (!in || magic != TRACE_MAGIC || version != TRACE_VERSION)
+    {
+        cerr << args.at(1) << ": not a trace file\n";
+        return 1;
+    }
 
-        readLeaderboard(maze.mazeNumber, leaderboard);
+    ofstream out(args.at(2));
+    out << "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"startTime\":" << startTime << "},\"traceEvents\":[";
 
-        if (!searchSameName(leaderboard, person, validInput, errorMessage))
-            return false;
+    static const char *causes[] = {"fence", "robot"};
+    TraceEvent event;
+    size_t count = 0;
+    // The state the game started in
+    uint32_t state = uint32_t(GameState::mainMenu);
 
-        if (!validInput)
-            return true;
+    out << "\n{\"name\":\"" << gameStateName(state) << "\",\"ph\":\"B\",\"ts\":0,\"pid\":1,\"tid\":1}";
 
-        sortLeaderboard(leaderboard);
+    while (in.read(reinterpret_cast<char *>(&event), sizeof(event)))
+    {
+        double ts = event.time / 1000.0;
+        out << ",\n{\"pid\":1,\"tid\":1,\"ts\":" << fixed << setprecision(3) << ts << ',';
 
-        cout << '\n';
-        printLeaderboard(cout, leaderboard);
-        cout << '\n';
+        switch (event.type)
+        {
+        case TraceEventType::stateChange:
+            // Ends the previous state and begins the next one
+            out << "\"ph\":\"E\",\"name\":\"" << gameStateName(state) << "\"},\n{\"pid\":1,\"tid\":1,\"ts\":" << ts
+                << ",\"ph\":\"B\",\"name\":\"" << gameStateName(event.detail) << "\"}";
+            state = event.detail;
+            break;
+        case TraceEventType::playerMove:
+            out << "\"ph\":\"i\",\"s\":\"t\",\"name\":\"playerMove\",\"args\":{\"key\":\"" << jsonEscape(string(1, event.detail))
+                << "\",\"turn\":" << event.a << ",\"cell\":" << event.b << "}}";
+            break;
+        case TraceEventType::playerDeath:
+            out << "\"ph\":\"i\",\"s\":\"g\",\"name\":\"playerDeath\",\"args\":{\"cause\":\"" << causes[event.detail % 2]
+                << "\",\"turn\":" << event.a << ",\"cell\":" << event.b << "}}";
+            break;
+        case TraceEventType::robotDeath:
+            out << "\"ph\":\"i\",\"s\":\"t\",\"name\":\"robotDeath\",\"args\":{\"cause\":\"" << causes[event.detail % 2]
+                << "\",\"robot\":" << event.a << ",\"cell\":" << event.b;
+            if (event.c)
+                out << ",\"otherRobot\":" << event.c - 1;
+            out << "}}";
+            break;
+        case TraceEventType::mazeLoad:
+            out << "\"ph\":\"i\",\"s\":\"g\",\"name\":\"mazeLoad\",\"args\":{\"maze\":" << event.a << ",\"valid\":"
+                << (event.detail ? "true" : "false") << ",\"hash\":\"" << hex << event.b << dec << "\",\"robots\":" << event.c << "}}";
+            break;
+        case TraceEventType::leaderboardWrite:
+            out << "\"ph\":\"i\",\"s\":\"g\",\"name\":\"leaderboardWrite\",\"args\":{\"maze\":" << event.a << ",\"entries\":" << event.b << "}}";
+            break;
+        case TraceEventType::eventsDropped:
+            out << "\"ph\":\"i\",\"s\":\"g\",\"name\":\"eventsDropped\",\"args\":{\"count\":" << event.b << "}}";
+            break;
+        default:
+            out << "\"ph\":\"i\",\"s\":\"t\",\"name\":\"unknown\"}";
+        }
 
-        saveLeaderboard(maze.mazeNumber, leaderboard);
+        count++;
     }
-    else
-        cout << "You lose :(\n";
 
-    cout << "Press enter to continue\n";
-    gameState = GameState::mainMenu;
-
-    string i;
-    return getInput(i);
+    out << "\n]}\n";
+    cerr << count << " events exported\n";
+    return 0;
 }
 
-int main()
+/**
+ * Runs the game until the user leaves.
+ * 
+ * @returns The exit code
+ */
+int playGame()
 {
     /** Whether the program is running */
     bool running = true;
     /** Whether the last input was valid */
     bool validInput = true;
+    /** Whether the user chose to play in real time */
+    bool realTime = false;
     /** The message to show if the input was invalid */
     string errorMessage;
     /** The game state */
     GameState gameState = GameState::mainMenu;
     /** Information about the maze */
     Maze maze;
+    /** What is on screen */
+    Renderer renderer;
 
     while (running)
     {
         if (!validInput)
             cout << errorMessage << "\n\n";
 
+        GameState previousState = gameState;
+
         switch (gameState)
         {
         case GameState::mainMenu:
-            running = mainMenu(gameState, validInput, errorMessage);
+            running = mainMenu(gameState, realTime, validInput, errorMessage);
             break;
         case GameState::mazeMenu:
-            running = mazeMenu(gameState, maze, validInput, errorMessage);
+            running = mazeMenu(gameState, maze, realTime, validInput, errorMessage);
             break;
         case GameState::inGame:
-            running = inGame(gameState, maze, validInput, errorMessage);
+            running = inGame(gameState, maze, renderer, validInput, errorMessage);
             break;
         case GameState::finished:
             running = finished(gameState, maze, validInput, errorMessage);
             break;
         }
+
+        if (gameState != previousState)
+            traceEvent(TraceEventType::stateChange, uint8_t(gameState), uint32_t(previousState));
+    }
+
+    return 0;
+}
+
+/**
+ * Runs one of the command line tools instead of the game.
+ * 
+ * @param args The command line arguments, the first one being the tool's name
+ * @returns The exit code
+ */
+int runTool(const vector<string> &args)
+{
+    if (args.at(0) == "--validate")
+        return validateCommand(args);
+    if (args.at(0) == "--tournament")
+        return tournamentCommand(args);
+    if (args.at(0) == "--verify")
+        return verifyCommand(args);
+    if (args.at(0) == "--trace-export")
+        return traceExportCommand(args);
+    if (args.at(0) == "--tile")
+        return tileCommand(args);
+    if (args.at(0) == "--analyze")
+        return analyzeCommand(args);
+
+    if (args.at(0) == "--trace" && args.size() == 2)
+    {
+        Tracer tracer;
+        if (!startTracing(tracer, args.at(1)))
+        {
+            cerr << args.at(1) << ": could not create trace file\n";
+            return 1;
+        }
+
+        int code = playGame();
+        stopTracing(tracer);
+        return code;
     }
+
+    cerr << "Unknown option: " << args.at(0) << "\n\n"
+            "Usage:\n"
+            "\t(no arguments)                                  Play the game\n"
+            "\t--validate <directory> [--threads N] [--summary FILE]   Validate every maze file in a directory\n"
+            "\t--tournament [--threads N] [--turns MAX] [--record] [mazes...]  Play every bot on every maze and rank them\n"
+            "\t--verify [--threads N] [mazes...]                        Re-play every leaderboard entry to check it\n"
+            "\t--analyze [--threads N] [--output DIR] [--summary FILE] [mazes...]  Re-play recorded games into heatmaps\n"
+            "\t--trace <trace file>                                     Play the game, recording events to a file\n"
+            "\t--trace-export <trace file> <json file>                  Convert a trace for trace viewers\n"
+            "\t--tile <mazes...>                                        Convert mazes to tiled files, for mazes too big for memory\n";
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    // Command line tools
+    if (argc > 1)
+        return runTool(vector<string>(argv + 1, argv + argc));
+
+    return playGame();
 }